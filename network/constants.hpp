@@ -35,6 +35,8 @@ namespace ezecs::network {
 		ID_SYNC_TRACKCONTROLS,
 		ID_SYNC_FREECONTROLS,
 		ID_SYNC_MULTIPLE_CONTROLS,
+		ID_SYNC_ECS_DELTA,
+		ID_SYNC_ECS_DELTA_ACK,
 
 		ID_USER_PACKET_END_ENUM
 	};
@@ -0,0 +1,259 @@
+/*
+ * Copyright (c) 2016 Galen Cochrane
+ * Galen Cochrane <galencochrane@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Allocators for ezecs storage.
+ *
+ * FixedPool hands out blocks of a single size from large chunks, keeping freed blocks on a free list for re-use. Chunks
+ * are only returned to the system when the program ends, so a long-running process that keeps adding and removing
+ * components reaches a steady memory footprint instead of fragmenting the heap. PoolAllocator is a standard allocator
+ * that takes single objects from the FixedPool for their size (such as the nodes of a std::unordered_map), and arrays
+ * of up to maxPooledArray bytes from the FixedPool for their size rounded up to a power of two (such as the pages and
+ * dense arrays of a SparseSet). Larger arrays are passed on to the default allocator.
+ *
+ * FrameArena is a bump allocator for transient data that lives for at most one frame (or tick). Everything in it is
+ * released at once by reset(). ArenaAllocator lets standard containers use one. EntityCommandBuffer keeps the
+ * components it queues in FrameArenas, which each flush resets.
+ *
+ * KvMapAllocator chooses the allocator that KvMap uses for a given value type. Component types given the 'pooled'
+ * attribute in the config file (see EZECS_COMPONENT_ATTRIBS) get a PoolAllocator, and everything else uses the default.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <vector>
+
+namespace ezecs {
+
+  template<size_t blockSize, size_t blockAlign>
+  class FixedPool {
+    public:
+      static FixedPool &instance();
+      void *allocate();
+      void deallocate(void *block);
+
+    private:
+      struct FreeBlock {
+        FreeBlock *next;
+      };
+      // Every block has to be able to hold a FreeBlock while it is free
+      static constexpr size_t align = blockAlign < alignof(FreeBlock) ? alignof(FreeBlock) : blockAlign;
+      static constexpr size_t size = blockSize < sizeof(FreeBlock) ? sizeof(FreeBlock) : blockSize;
+      static constexpr size_t stride = (size + align - 1) / align * align;
+      static constexpr size_t blocksPerChunk = stride >= 4096 ? 16 : 65536 / stride;
+      std::mutex mutex;
+      FreeBlock *freeList = nullptr;
+      std::vector<std::unique_ptr<std::byte[]>> chunks;
+
+      FixedPool() = default;
+      void grow();
+  };
+
+  /*
+   * Arrays from minPooledArray to maxPooledArray bytes are pooled, by power of two
+   */
+  constexpr size_t minPooledArray = 16;
+  constexpr size_t maxPooledArray = 65536;
+  template<size_t blockSize = minPooledArray>
+  void *allocatePooledArray(size_t size);
+  template<size_t blockSize = minPooledArray>
+  void deallocatePooledArray(void *block, size_t size);
+
+  template<class T>
+  class PoolAllocator {
+    public:
+      typedef T value_type;
+
+      PoolAllocator() = default;
+      template<class U>
+      PoolAllocator(const PoolAllocator<U> &) { }
+
+      T *allocate(size_t n);
+      void deallocate(T *p, size_t n);
+
+      template<class U>
+      bool operator == (const PoolAllocator<U> &) const { return true; }
+      template<class U>
+      bool operator != (const PoolAllocator<U> &) const { return false; }
+  };
+
+  class FrameArena {
+    public:
+      explicit FrameArena(size_t chunkSize = 1 << 20);
+      FrameArena(const FrameArena &) = delete;
+      FrameArena &operator = (const FrameArena &) = delete;
+
+      void *allocate(size_t size, size_t align = alignof(std::max_align_t));
+
+      /*
+       * Releases everything allocated since the last reset. Memory is kept for re-use, so a steady workload stops
+       * allocating from the system after its first few frames.
+       */
+      void reset();
+      size_t bytesUsed() const;
+
+    private:
+      struct Chunk {
+        std::unique_ptr<std::byte[]> memory;
+        size_t size;
+      };
+      std::vector<Chunk> chunks;
+      size_t chunkSize;
+      size_t currentChunk = 0;
+      size_t offset = 0;
+      size_t used = 0;
+  };
+
+  template<class T>
+  class ArenaAllocator {
+    public:
+      typedef T value_type;
+
+      explicit ArenaAllocator(FrameArena &arena) : arena(&arena) { }
+      template<class U>
+      ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) { }
+
+      T *allocate(size_t n) { return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T))); }
+      void deallocate(T *, size_t) { } // freed all at once by FrameArena::reset
+
+      template<class U>
+      bool operator == (const ArenaAllocator<U> &other) const { return arena == other.arena; }
+      template<class U>
+      bool operator != (const ArenaAllocator<U> &other) const { return arena != other.arena; }
+
+      FrameArena *arena;
+  };
+
+  template<class V>
+  struct KvMapAllocator {
+    typedef std::allocator<V> type;
+  };
+
+  template<size_t blockSize, size_t blockAlign>
+  FixedPool<blockSize, blockAlign> &FixedPool<blockSize, blockAlign>::instance() {
+    static FixedPool *pool = new FixedPool; // never destroyed, since containers may outlive any static destructor
+    return *pool;
+  }
+  template<size_t blockSize, size_t blockAlign>
+  void *FixedPool<blockSize, blockAlign>::allocate() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if ( ! freeList) {
+      grow();
+    }
+    FreeBlock *block = freeList;
+    freeList = block->next;
+    return block;
+  }
+  template<size_t blockSize, size_t blockAlign>
+  void FixedPool<blockSize, blockAlign>::deallocate(void *block) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto freed = static_cast<FreeBlock*>(block);
+    freed->next = freeList;
+    freeList = freed;
+  }
+  template<size_t blockSize, size_t blockAlign>
+  void FixedPool<blockSize, blockAlign>::grow() {
+    chunks.emplace_back(new std::byte[stride * blocksPerChunk + align]);
+    auto base = reinterpret_cast<uintptr_t>(chunks.back().get());
+    base = (base + align - 1) / align * align;
+    for (size_t i = blocksPerChunk; i-- > 0; ) { // linked so that blocks are handed out in address order
+      auto block = reinterpret_cast<FreeBlock*>(base + i * stride);
+      block->next = freeList;
+      freeList = block;
+    }
+  }
+
+  template<size_t blockSize>
+  void *allocatePooledArray(size_t size) {
+    if constexpr (blockSize < maxPooledArray) {
+      if (size > blockSize) {
+        return allocatePooledArray<blockSize * 2>(size);
+      }
+    }
+    return FixedPool<blockSize, alignof(std::max_align_t)>::instance().allocate();
+  }
+  template<size_t blockSize>
+  void deallocatePooledArray(void *block, size_t size) {
+    if constexpr (blockSize < maxPooledArray) {
+      if (size > blockSize) {
+        deallocatePooledArray<blockSize * 2>(block, size);
+        return;
+      }
+    }
+    FixedPool<blockSize, alignof(std::max_align_t)>::instance().deallocate(block);
+  }
+
+  template<class T>
+  T *PoolAllocator<T>::allocate(size_t n) {
+    if (n == 1) {
+      return static_cast<T*>(FixedPool<sizeof(T), alignof(T)>::instance().allocate());
+    }
+    if (n <= maxPooledArray / sizeof(T) && alignof(T) <= alignof(std::max_align_t)) {
+      return static_cast<T*>(allocatePooledArray(n * sizeof(T)));
+    }
+    return std::allocator<T>().allocate(n);
+  }
+  template<class T>
+  void PoolAllocator<T>::deallocate(T *p, size_t n) {
+    if (n == 1) {
+      FixedPool<sizeof(T), alignof(T)>::instance().deallocate(p);
+    } else if (n <= maxPooledArray / sizeof(T) && alignof(T) <= alignof(std::max_align_t)) {
+      deallocatePooledArray(p, n * sizeof(T));
+    } else {
+      std::allocator<T>().deallocate(p, n);
+    }
+  }
+
+  inline FrameArena::FrameArena(size_t chunkSize) : chunkSize(chunkSize) { }
+  inline void *FrameArena::allocate(size_t size, size_t align) {
+    while (true) {
+      if (currentChunk < chunks.size()) {
+        auto base = reinterpret_cast<uintptr_t>(chunks[currentChunk].memory.get());
+        size_t start = (base + offset + align - 1) / align * align - base;
+        if (start + size <= chunks[currentChunk].size) {
+          offset = start + size;
+          used += size;
+          return reinterpret_cast<void*>(base + start);
+        }
+        ++currentChunk;
+        offset = 0;
+      } else {
+        size_t newSize = size + align > chunkSize ? size + align : chunkSize;
+        chunks.push_back(Chunk{ std::unique_ptr<std::byte[]>(new std::byte[newSize]), newSize });
+      }
+    }
+  }
+  inline void FrameArena::reset() {
+    currentChunk = 0;
+    offset = 0;
+    used = 0;
+  }
+  inline size_t FrameArena::bytesUsed() const {
+    return used;
+  }
+}
@@ -0,0 +1,624 @@
+/*
+ * Copyright (c) 2016 Galen Cochrane
+ * Galen Cochrane <galencochrane@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * An archetype is the set of all entities that have exactly the same components (the same
+ * Existence::componentsPresent mask). When EZECS_ARCHETYPES is defined (see the CMake option of the same name), State
+ * stores components by archetype rather than by type. The entities of an archetype live in fixed-size chunks, each of
+ * which holds an array of their IDs followed by one array per component type (a structure of arrays), laid out from the
+ * sizes and alignments that the generator puts in CompTraits. Adding or removing a component moves the entity, along
+ * with all of its other components, to the archetype of its new mask. Visiting the entities that have at least some
+ * set of components is then a linear walk through the arrays of the few archetypes whose masks match.
+ *
+ * Existence components are still kept by State in a collection of their own, since every operation looks them up.
+ * Each other component type's collection in State is an ArchetypeColumn, which looks into this storage.
+ * Since the last entity of an archetype is moved into the place of one that leaves it, a pointer to a component is only
+ * valid until the next addition or removal of a component. Do not add or remove components while iterating.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "ecsTypes.hpp"
+#include "ecsKvMap.hpp"
+#include "ecsMemory.hpp"
+
+namespace ezecs {
+
+#ifdef EZECS_ARCHETYPES
+  /*
+   * What the storage needs to know to lay out, move and destroy the components of a type without knowing the type
+   */
+  struct ColumnType {
+    compMask flag;
+    size_t size;
+    size_t alignment;
+    void (*relocate)(void* to, void* from); // move-constructs at 'to' and destroys what is at 'from'
+    void (*destroy)(void* at);
+
+    template<typename compType>
+    static constexpr ColumnType of() {
+      return ColumnType{ CompTraits<compType>::flag, CompTraits<compType>::size, CompTraits<compType>::alignment,
+                         [](void* to, void* from) {
+                           new (to) compType(std::move(*static_cast<compType*>(from)));
+                           static_cast<compType*>(from)->~compType();
+                         },
+                         [](void* at) { static_cast<compType*>(at)->~compType(); } };
+    }
+  };
+
+  /*
+   * ColumnTables holds the ColumnType of every type in a CompTypeList, in order, so that they can be looked up by index.
+   */
+  template<typename typeList>
+  struct ColumnTables;
+  template<typename ... compTypes>
+  struct ColumnTables<CompTypeList<compTypes...>> {
+    static constexpr ColumnType types[] = { ColumnType::of<compTypes>()... };
+  };
+  inline const ColumnType &columnType(uint8_t index) { return ColumnTables<AllCompTypes>::types[index]; }
+
+  struct Archetype {
+    static constexpr uint32_t noColumn = ~uint32_t(0);
+
+    compMask mask;
+    size_t capacity = 0;                          // entities per chunk
+    size_t rowSize = sizeof(entityId);            // bytes per entity, its ID included
+    size_t chunkSize = 0;                         // bytes per chunk
+    size_t chunkAlignment = alignof(entityId);
+    std::array<uint32_t, AllCompTypes::size> offsets; // of the array of each type within a chunk, or noColumn
+    std::vector<uint8_t> types;                   // the indices of the types that have arrays
+    std::vector<std::byte*> chunks;
+    size_t count = 0;                             // entities, packed at the front of the chunks
+
+    entityId &idAt(size_t row) const {
+      return reinterpret_cast<entityId*>(chunks[row / capacity])[row % capacity];
+    }
+    void* at(uint8_t type, size_t row) const {
+      return chunks[row / capacity] + offsets[type] + row % capacity * columnType(type).size;
+    }
+  };
+
+  /*
+   * One chunk of an archetype: its entities' IDs and the arrays of their components, size() of each
+   */
+  class ArchetypeChunk {
+    public:
+      ArchetypeChunk(const Archetype &archetype, std::byte* data, size_t count)
+          : archetype(&archetype), data(data), count(count) { }
+      const entityId* ids() const { return reinterpret_cast<const entityId*>(data); }
+      size_t size() const { return count; }
+
+      /*
+       * The array of the given component type, or nullptr if the archetype does not have that type (or it is Existence)
+       */
+      template<typename compType>
+      compType* column() const {
+        uint32_t offset = archetype->offsets[CompTraits<compType>::index];
+        return offset == Archetype::noColumn ? nullptr : reinterpret_cast<compType*>(data + offset);
+      }
+
+    private:
+      const Archetype *archetype;
+      std::byte* data;
+      size_t count;
+  };
+
+  template<typename compType, typename VRef>
+  class ArchetypeColumnIterator;
+
+  class ArchetypeStorage {
+    public:
+      /*
+       * The size of a chunk, unless a single entity's components take more than that
+       */
+      static constexpr size_t chunkBytes = 16384;
+
+      ArchetypeStorage() = default;
+      ~ArchetypeStorage();
+      ArchetypeStorage(const ArchetypeStorage &) = delete;
+      ArchetypeStorage &operator = (const ArchetypeStorage &) = delete;
+
+      /*
+       * Files a new entity under the archetype that has no components but Existence
+       */
+      void insert(const entityId &id);
+
+      /*
+       * Destroys all of an entity's components and forgets the entity
+       */
+      void erase(const entityId &id);
+
+      /*
+       * Destroys every component and forgets every entity. The chunks are kept to be used again.
+       */
+      void clear();
+
+      /*
+       * Constructs a component for an entity from args, moving the entity to the archetype that adds the component's
+       * type. Returns false (having done nothing) if the entity already has a component of that type.
+       */
+      template<typename compType, typename ... Args>
+      bool emplace(const entityId &id, Args &&... args);
+
+      /*
+       * Destroys a component of an entity, moving the entity to the archetype without that type. Returns false if the
+       * entity has no component of that type.
+       */
+      template<typename compType>
+      bool remove(const entityId &id);
+
+      template<typename compType>
+      compType* find(const entityId &id);
+      template<typename compType>
+      bool has(const entityId &id) const;
+      template<typename compType>
+      size_t count() const;
+      size_t numArchetypes() const;
+
+      /*
+       * Calls fn(const ArchetypeChunk &chunk) for each chunk of the entities that have all of the components in
+       * 'required' (and possibly others).
+       */
+      template<typename Fn>
+      void forEachChunk(const compMask &required, Fn &&fn);
+
+      /*
+       * Calls fn(const entityId &id) for each entity that has all of the components in 'required'.
+       */
+      template<typename Fn>
+      void forEach(const compMask &required, Fn &&fn);
+
+      /*
+       * The components are measured by each ArchetypeColumn (see memoryUsageOf), so this counts the rest: the IDs and
+       * locations of entities as overhead, and the room for more of them along with the padding in chunks as slack.
+       */
+      MemoryUsage memoryUsage() const;
+      template<typename compType>
+      MemoryUsage memoryUsageOf() const;
+
+      /*
+       * Gives back the chunks that no entity uses
+       */
+      void shrinkToFit();
+
+    private:
+      template<typename, typename> friend class ArchetypeColumnIterator;
+      static constexpr uint32_t noArchetype = ~uint32_t(0);
+      struct Location {
+        uint32_t archetype;
+        uint32_t row;
+      };
+      std::vector<Archetype> archetypes;
+      std::unordered_map<compMask, uint32_t> archetypesByMask;
+      std::unordered_map<compMask, std::vector<uint32_t>> matchesByQuery;
+      std::vector<Location> locations; // by entity index
+      std::array<size_t, AllCompTypes::size> typeCounts = { };
+
+      Location *locate(const entityId &id);
+      const Location *locate(const entityId &id) const;
+      uint32_t archetypeFor(const compMask &mask);
+      const std::vector<uint32_t> &matchesFor(const compMask &required);
+      uint32_t pushRow(uint32_t archetype, const entityId &id);
+      void moveRow(uint32_t from, uint32_t row, uint32_t to, uint32_t newRow, const std::vector<uint8_t> &types);
+      void vacate(uint32_t archetype, uint32_t row);
+      static void freeChunk(const Archetype &archetype, std::byte* chunk);
+  };
+
+  template<typename compType, typename VRef>
+  class ArchetypeColumnIterator {
+    public:
+      typedef std::pair<const entityId&, VRef> reference;
+      struct pointer {
+        reference ref;
+        reference* operator -> () { return &ref; }
+      };
+
+      ArchetypeColumnIterator(const ArchetypeStorage *storage, size_t archetype)
+          : storage(storage), archetype(archetype) { skipEmpty(); }
+      reference operator * () const {
+        const Archetype &arch = storage->archetypes[archetype];
+        return reference(arch.idAt(row), *static_cast<compType*>(arch.at(CompTraits<compType>::index, row)));
+      }
+      pointer operator -> () const { return pointer{ **this }; }
+      ArchetypeColumnIterator& operator ++ () {
+        if (++row == storage->archetypes[archetype].count) {
+          row = 0;
+          ++archetype;
+          skipEmpty();
+        }
+        return *this;
+      }
+      bool operator == (const ArchetypeColumnIterator& other) const {
+        return archetype == other.archetype && row == other.row;
+      }
+      bool operator != (const ArchetypeColumnIterator& other) const { return ! (*this == other); }
+
+    private:
+      const ArchetypeStorage *storage;
+      size_t archetype;
+      size_t row = 0;
+
+      void skipEmpty() { // past the archetypes that have none of these components
+        while (archetype < storage->archetypes.size() &&
+               ( ! storage->archetypes[archetype].count ||
+                 storage->archetypes[archetype].offsets[CompTraits<compType>::index] == Archetype::noColumn)) {
+          ++archetype;
+        }
+      }
+  };
+
+  /*
+   * The components of one type, wherever they are in an ArchetypeStorage, behind the same interface as a KvMap.
+   * Iteration goes archetype by archetype.
+   */
+  template<typename compType>
+  class ArchetypeColumn {
+    public:
+      typedef ArchetypeColumnIterator<compType, compType&> iterator;
+      typedef ArchetypeColumnIterator<compType, const compType&> const_iterator;
+
+      explicit ArchetypeColumn(ArchetypeStorage &storage) : storage(&storage) { }
+      compType &at(const entityId &id);
+      compType* find(const entityId &id) { return storage->find<compType>(id); }
+      const compType* find(const entityId &id) const { return storage->find<compType>(id); }
+      bool contains(const entityId &id) const { return storage->has<compType>(id); }
+      size_t count(const entityId &id) const { return storage->has<compType>(id); }
+      template<class... Args>
+      bool try_emplace(const entityId &id, Args &&... args) {
+        return storage->emplace<compType>(id, std::forward<Args>(args)...);
+      }
+      bool insert(const entityId &id, compType &&value) { return storage->emplace<compType>(id, std::move(value)); }
+      size_t insertBulk(const entityId* ids, compType* values, size_t count);
+      bool erase(const entityId &id) { return storage->remove<compType>(id); }
+      void reserve(size_t) { } // chunks are allocated as they are needed
+      size_t size() const { return storage->count<compType>(); }
+
+      /*
+       * Removes every component of this type, moving each of their entities to its new archetype
+       */
+      void clear();
+
+      iterator begin() { return iterator(storage, 0); }
+      iterator end() { return iterator(storage, storage->numArchetypes()); }
+      const_iterator begin() const { return const_iterator(storage, 0); }
+      const_iterator end() const { return const_iterator(storage, storage->numArchetypes()); }
+      MemoryUsage memoryUsage() const { return storage->memoryUsageOf<compType>(); }
+      void shrinkToFit() { } // the storage is shrunk as a whole
+
+    private:
+      ArchetypeStorage *storage;
+  };
+
+  inline ArchetypeStorage::~ArchetypeStorage() {
+    clear();
+    for (auto &archetype : archetypes) {
+      for (auto chunk : archetype.chunks) {
+        freeChunk(archetype, chunk);
+      }
+    }
+  }
+  inline void ArchetypeStorage::insert(const entityId &id) {
+    size_t index = entityIndex(id);
+    if (index >= locations.size()) {
+      locations.resize(index + 1, Location{ noArchetype, 0 });
+    }
+    if (locate(id)) {
+      return;
+    }
+    uint32_t archetype = archetypeFor(Existence::flag);
+    locations[index] = Location{ archetype, pushRow(archetype, id) };
+  }
+  inline void ArchetypeStorage::erase(const entityId &id) {
+    Location *location = locate(id);
+    if ( ! location) {
+      return;
+    }
+    Location old = *location;
+    *location = Location{ noArchetype, 0 };
+    const Archetype &archetype = archetypes[old.archetype];
+    for (auto type : archetype.types) {
+      columnType(type).destroy(archetype.at(type, old.row));
+      --typeCounts[type];
+    }
+    vacate(old.archetype, old.row);
+  }
+  inline void ArchetypeStorage::clear() {
+    for (auto &archetype : archetypes) {
+      for (size_t row = 0; row < archetype.count; ++row) {
+        for (auto type : archetype.types) {
+          columnType(type).destroy(archetype.at(type, row));
+        }
+      }
+      archetype.count = 0;
+    }
+    locations.clear();
+    typeCounts.fill(0);
+  }
+  template<typename compType, typename ... Args>
+  bool ArchetypeStorage::emplace(const entityId &id, Args &&... args) {
+    constexpr uint8_t type = CompTraits<compType>::index;
+    if ( ! locate(id)) {
+      insert(id);
+    }
+    Location location = *locate(id);
+    if (archetypes[location.archetype].offsets[type] != Archetype::noColumn) {
+      return false;
+    }
+    uint32_t to = archetypeFor(archetypes[location.archetype].mask | CompTraits<compType>::flag);
+    uint32_t row = pushRow(to, id);
+    try { // the new component is made first, so that nothing has moved if it throws
+      new (archetypes[to].at(type, row)) compType(std::forward<Args>(args)...);
+    } catch (...) {
+      --archetypes[to].count;
+      throw;
+    }
+    moveRow(location.archetype, location.row, to, row, archetypes[location.archetype].types);
+    vacate(location.archetype, location.row);
+    locations[entityIndex(id)] = Location{ to, row };
+    ++typeCounts[type];
+    return true;
+  }
+  template<typename compType>
+  bool ArchetypeStorage::remove(const entityId &id) {
+    constexpr uint8_t type = CompTraits<compType>::index;
+    Location *found = locate(id);
+    if ( ! found || archetypes[found->archetype].offsets[type] == Archetype::noColumn) {
+      return false;
+    }
+    Location location = *found;
+    uint32_t to = archetypeFor(archetypes[location.archetype].mask & ~CompTraits<compType>::flag);
+    uint32_t row = pushRow(to, id);
+    static_cast<compType*>(archetypes[location.archetype].at(type, location.row))->~compType();
+    moveRow(location.archetype, location.row, to, row, archetypes[to].types);
+    vacate(location.archetype, location.row);
+    locations[entityIndex(id)] = Location{ to, row };
+    --typeCounts[type];
+    return true;
+  }
+  template<typename compType>
+  compType* ArchetypeStorage::find(const entityId &id) {
+    Location *location = locate(id);
+    if ( ! location || archetypes[location->archetype].offsets[CompTraits<compType>::index] == Archetype::noColumn) {
+      return nullptr;
+    }
+    return static_cast<compType*>(archetypes[location->archetype].at(CompTraits<compType>::index, location->row));
+  }
+  template<typename compType>
+  bool ArchetypeStorage::has(const entityId &id) const {
+    const Location *location = locate(id);
+    return location &&
+           archetypes[location->archetype].offsets[CompTraits<compType>::index] != Archetype::noColumn;
+  }
+  template<typename compType>
+  size_t ArchetypeStorage::count() const {
+    return typeCounts[CompTraits<compType>::index];
+  }
+  inline size_t ArchetypeStorage::numArchetypes() const {
+    return archetypes.size();
+  }
+  template<typename Fn>
+  void ArchetypeStorage::forEachChunk(const compMask &required, Fn &&fn) {
+    for (auto index : matchesFor(required)) {
+      const Archetype &archetype = archetypes[index];
+      for (size_t begin = 0; begin < archetype.count; begin += archetype.capacity) {
+        fn(ArchetypeChunk(archetype, archetype.chunks[begin / archetype.capacity],
+                          std::min(archetype.capacity, archetype.count - begin)));
+      }
+    }
+  }
+  template<typename Fn>
+  void ArchetypeStorage::forEach(const compMask &required, Fn &&fn) {
+    for (auto index : matchesFor(required)) {
+      const Archetype &archetype = archetypes[index];
+      for (size_t row = 0; row < archetype.count; ++row) {
+        fn(archetype.idAt(row));
+      }
+    }
+  }
+  inline MemoryUsage ArchetypeStorage::memoryUsage() const {
+    MemoryUsage usage = MemoryUsage::of(locations, true);
+    usage.overhead += archetypes.capacity() * sizeof(Archetype);
+    for (auto &archetype : archetypes) {
+      size_t rows = archetype.chunks.size() * archetype.capacity;
+      usage.overhead += archetype.count * sizeof(entityId) + archetype.types.capacity() +
+                        archetype.chunks.capacity() * sizeof(std::byte*);
+      usage.slack += (rows - archetype.count) * sizeof(entityId) +
+                     archetype.chunks.size() * (archetype.chunkSize - archetype.capacity * archetype.rowSize);
+    }
+    return usage;
+  }
+  template<typename compType>
+  MemoryUsage ArchetypeStorage::memoryUsageOf() const {
+    MemoryUsage usage;
+    usage.payload = count<compType>() * sizeof(compType);
+    for (auto &archetype : archetypes) {
+      if (archetype.offsets[CompTraits<compType>::index] != Archetype::noColumn) {
+        usage.slack += (archetype.chunks.size() * archetype.capacity - archetype.count) * sizeof(compType);
+      }
+    }
+    return usage;
+  }
+  inline void ArchetypeStorage::shrinkToFit() {
+    for (auto &archetype : archetypes) {
+      size_t needed = (archetype.count + archetype.capacity - 1) / archetype.capacity;
+      for (size_t i = needed; i < archetype.chunks.size(); ++i) {
+        freeChunk(archetype, archetype.chunks[i]);
+      }
+      archetype.chunks.resize(needed);
+      archetype.chunks.shrink_to_fit();
+    }
+    while ( ! locations.empty() && locations.back().archetype == noArchetype) {
+      locations.pop_back();
+    }
+    locations.shrink_to_fit();
+  }
+  inline ArchetypeStorage::Location *ArchetypeStorage::locate(const entityId &id) {
+    return const_cast<Location*>(static_cast<const ArchetypeStorage*>(this)->locate(id));
+  }
+  inline const ArchetypeStorage::Location *ArchetypeStorage::locate(const entityId &id) const {
+    size_t index = entityIndex(id);
+    if (index >= locations.size() || locations[index].archetype == noArchetype) {
+      return nullptr;
+    }
+    const Location &location = locations[index];
+    return archetypes[location.archetype].idAt(location.row) == id ? &location : nullptr; // not an older generation
+  }
+  inline uint32_t ArchetypeStorage::archetypeFor(const compMask &mask) {
+    auto found = archetypesByMask.find(mask);
+    if (found != archetypesByMask.end()) {
+      return found->second;
+    }
+    // The chunk layout: as many entities as fit, with their IDs first and then an array for each type
+    Archetype archetype;
+    archetype.mask = mask;
+    archetype.offsets.fill(Archetype::noColumn);
+    for (uint8_t type = 1; type < AllCompTypes::size; ++type) { // Existence is kept apart by State
+      if (mask & columnType(type).flag) {
+        archetype.types.push_back(type);
+        archetype.rowSize += columnType(type).size;
+        archetype.chunkAlignment = std::max(archetype.chunkAlignment, columnType(type).alignment);
+      }
+    }
+    archetype.capacity = std::max<size_t>(1, chunkBytes / archetype.rowSize);
+    while (true) {
+      size_t offset = archetype.capacity * sizeof(entityId);
+      for (auto type : archetype.types) {
+        size_t alignment = columnType(type).alignment;
+        offset = (offset + alignment - 1) / alignment * alignment;
+        archetype.offsets[type] = static_cast<uint32_t>(offset);
+        offset += archetype.capacity * columnType(type).size;
+      }
+      archetype.chunkSize = offset;
+      if (offset <= chunkBytes || archetype.capacity == 1) {
+        break;
+      }
+      --archetype.capacity; // the arrays did not fit once padded for alignment
+    }
+    auto index = static_cast<uint32_t>(archetypes.size());
+    archetypes.push_back(std::move(archetype));
+    archetypesByMask.emplace(mask, index);
+    for (auto &query : matchesByQuery) { // keep cached query results up to date
+      if (hasAll(mask, query.first)) {
+        query.second.push_back(index);
+      }
+    }
+    return index;
+  }
+  inline const std::vector<uint32_t> &ArchetypeStorage::matchesFor(const compMask &required) {
+    auto found = matchesByQuery.find(required);
+    if (found != matchesByQuery.end()) {
+      return found->second;
+    }
+    std::vector<uint32_t> matches;
+    for (uint32_t i = 0; i < archetypes.size(); ++i) {
+      if (hasAll(archetypes[i].mask, required)) {
+        matches.push_back(i);
+      }
+    }
+    return matchesByQuery.emplace(required, std::move(matches)).first->second;
+  }
+  inline uint32_t ArchetypeStorage::pushRow(uint32_t index, const entityId &id) {
+    Archetype &archetype = archetypes[index];
+    if (archetype.count == archetype.chunks.size() * archetype.capacity) {
+      archetype.chunks.reserve(archetype.chunks.size() + 1);
+      archetype.chunks.push_back(static_cast<std::byte*>(
+          ::operator new(archetype.chunkSize, std::align_val_t(archetype.chunkAlignment))));
+    }
+    size_t row = archetype.count++;
+    archetype.idAt(row) = id;
+    return static_cast<uint32_t>(row);
+  }
+  inline void ArchetypeStorage::moveRow(uint32_t from, uint32_t row, uint32_t to, uint32_t newRow,
+                                        const std::vector<uint8_t> &types) {
+    for (auto type : types) {
+      columnType(type).relocate(archetypes[to].at(type, newRow), archetypes[from].at(type, row));
+    }
+  }
+  inline void ArchetypeStorage::vacate(uint32_t index, uint32_t row) {
+    // The last entity moves into the row, whose components have already been moved out or destroyed
+    Archetype &archetype = archetypes[index];
+    size_t last = archetype.count - 1;
+    if (row != last) {
+      for (auto type : archetype.types) {
+        columnType(type).relocate(archetype.at(type, row), archetype.at(type, last));
+      }
+      entityId moved = archetype.idAt(last);
+      archetype.idAt(row) = moved;
+      locations[entityIndex(moved)].row = row;
+    }
+    --archetype.count;
+  }
+  inline void ArchetypeStorage::freeChunk(const Archetype &archetype, std::byte* chunk) {
+    ::operator delete(chunk, std::align_val_t(archetype.chunkAlignment));
+  }
+
+  template<typename compType>
+  compType &ArchetypeColumn<compType>::at(const entityId &id) {
+    compType* comp = find(id);
+    if ( ! comp) {
+      throw std::out_of_range("ArchetypeColumn::at");
+    }
+    return *comp;
+  }
+  template<typename compType>
+  size_t ArchetypeColumn<compType>::insertBulk(const entityId* ids, compType* values, size_t count) {
+    size_t inserted = 0;
+    for (size_t i = 0; i < count; ++i) {
+      inserted += insert(ids[i], std::move(values[i]));
+    }
+    return inserted;
+  }
+  template<typename compType>
+  void ArchetypeColumn<compType>::clear() {
+    std::vector<entityId> ids;
+    ids.reserve(size());
+    for (auto &&pair : *this) {
+      ids.push_back(pair.first);
+    }
+    for (auto &id : ids) {
+      erase(id);
+    }
+  }
+#endif
+
+  /*
+   * The type of the collection that State keeps the components of a type in (other than Existence, which is always
+   * in a KvMap)
+   */
+#ifdef EZECS_ARCHETYPES
+  template<typename compType>
+  using CompCollection = ArchetypeColumn<compType>;
+#else
+  template<typename compType>
+  using CompCollection = KvMap<entityId, compType>;
+#endif
+}
@@ -0,0 +1,94 @@
+/*
+ * Copyright (c) 2016 Galen Cochrane
+ * Galen Cochrane <galencochrane@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * A ChangeTracker remembers, for every entity, the change tick (see State::advanceChangeTick) at which one type of
+ * component was last added to it or accessed mutably (through get[component_name]Mut). State keeps one per component
+ * type, so that systems which only care about what changed can skip everything else.
+ *
+ * Ticks are stored in a plain array indexed by entity index (see ecsTypes.hpp), which is grown when components are
+ * added. Marking an existing component from several threads at once is safe as long as each thread marks different
+ * entities.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "ecsTypes.hpp"
+#include "ecsMemory.hpp"
+
+namespace ezecs {
+
+  typedef uint32_t changeTick;
+
+  class ChangeTracker {
+    public:
+      void mark(const entityId &id, const changeTick &tick);
+      changeTick lastChanged(const entityId &id) const;
+
+      /*
+       * True if the component was changed at any tick later than 'tick'
+       */
+      bool changedSince(const entityId &id, const changeTick &tick) const;
+      void clear();
+
+      MemoryUsage memoryUsage() const;
+
+      /*
+       * Forgets the ticks of every entity index at or above 'size' (which then read as never changed), and gives back
+       * unused capacity
+       */
+      void shrinkToFit(size_t size);
+
+    private:
+      std::vector<changeTick> ticks;
+  };
+
+  inline void ChangeTracker::mark(const entityId &id, const changeTick &tick) {
+    size_t index = entityIndex(id);
+    if (index >= ticks.size()) {
+      ticks.resize(index + 1, 0);
+    }
+    ticks[index] = tick;
+  }
+  inline changeTick ChangeTracker::lastChanged(const entityId &id) const {
+    size_t index = entityIndex(id);
+    return index < ticks.size() ? ticks[index] : 0;
+  }
+  inline bool ChangeTracker::changedSince(const entityId &id, const changeTick &tick) const {
+    return lastChanged(id) > tick;
+  }
+  inline void ChangeTracker::clear() {
+    ticks.clear();
+  }
+  inline MemoryUsage ChangeTracker::memoryUsage() const {
+    return MemoryUsage::of(ticks, true);
+  }
+  inline void ChangeTracker::shrinkToFit(size_t size) {
+    if (size < ticks.size()) {
+      ticks.resize(size);
+    }
+    ticks.shrink_to_fit();
+  }
+}
@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2016 Galen Cochrane
+ * Galen Cochrane <galencochrane@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <algorithm>
+#include "ecsCommandBuffer.hpp"
+
+namespace ezecs {
+
+  EntityCommandBuffer::EntityCommandBuffer(State &state) : state(state) { }
+
+  EntityCommandBuffer::~EntityCommandBuffer() {
+    destroy(ops);
+  }
+
+  PendingEntity EntityCommandBuffer::createEntity() {
+    std::lock_guard<std::mutex> lock(mutex);
+    PendingEntity entity { numPending++ };
+    ops.push_back(Op{ entity.index, true, OP_CREATE, nullptr });
+    return entity;
+  }
+
+  void EntityCommandBuffer::deleteEntity(const entityId &id) {
+    record(id, false, OP_DELETE);
+  }
+
+  void EntityCommandBuffer::deleteEntity(const PendingEntity &entity) {
+    record(entity.index, true, OP_DELETE);
+  }
+
+  void EntityCommandBuffer::flush() {
+    EZECS_PROFILE_SCOPE("EntityCommandBuffer::flush", "state");
+    std::vector<Op> toApply;
+    size_t applyingArena;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      toApply.swap(ops);
+      applyingArena = recordingArena;
+      recordingArena ^= 1;
+      created.assign(numPending, 0);
+      numPending = 0;
+    }
+
+    // Pending entities are created first, in the order they were queued, so that their operations can be sorted in
+    // with everyone else's.
+    for (auto &op : toApply) {
+      if (op.kind == OP_CREATE) {
+        state.createEntity(&created[op.target]);
+      }
+    }
+    for (auto &op : toApply) {
+      if (op.pending) {
+        op.target = created[op.target];
+        op.pending = false;
+      }
+    }
+
+    // Sorting by entity index walks storage in order. The sort is stable, so each entity's operations stay in the order
+    // they were recorded.
+    std::stable_sort(toApply.begin(), toApply.end(), [](const Op &a, const Op &b) {
+      return entityIndex(a.target) < entityIndex(b.target) ||
+             (entityIndex(a.target) == entityIndex(b.target) && a.target < b.target);
+    });
+    for (size_t begin = 0, end; begin < toApply.size(); begin = end) {
+      for (end = begin + 1; end < toApply.size() && toApply[end].target == toApply[begin].target; ++end) { }
+      if (toApply[begin].target) { // a pending entity that could not be created has ID 0
+        flushEntity(toApply[begin].target, toApply.data() + begin, toApply.data() + end);
+      }
+    }
+    destroy(toApply);
+    arenas[applyingArena].reset();
+  }
+
+  entityId EntityCommandBuffer::resolve(const PendingEntity &entity) const {
+    return entity.index < created.size() ? created[entity.index] : 0;
+  }
+
+  bool EntityCommandBuffer::empty() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return ops.empty();
+  }
+
+  void EntityCommandBuffer::record(entityId target, bool pending, OpKind kind) {
+    std::lock_guard<std::mutex> lock(mutex);
+    ops.push_back(Op{ target, pending, kind, nullptr });
+  }
+
+  void EntityCommandBuffer::destroy(std::vector<Op> &ops) {
+    for (auto &op : ops) {
+      if (op.comp) {
+        op.comp->~CompOp(); // the memory goes with the arena
+      }
+    }
+    ops.clear();
+  }
+
+  void EntityCommandBuffer::flushEntity(const entityId &id, Op *begin, Op *end) {
+    Existence *existence = state.comps_Existence.find(id);
+    if ( ! existence) {
+      return;
+    }
+    for (Op *op = begin; op != end; ++op) {
+      if (op->kind == OP_DELETE) { // nothing else queued for the entity matters
+        state.deleteEntity(id);
+        return;
+      }
+    }
+
+    // Fold the operations together, skipping any that would have been redundant if made directly. For each component
+    // type, keep the last operation on it, which holds the final value if the component ends up added or replaced.
+    compMask before = existence->componentsPresent;
+    compMask after = before;
+    compMask replaced = 0;
+    std::vector<std::pair<compMask, CompOp*>> lastOps;
+    auto lastOpFor = [&lastOps](const compMask &flag) -> CompOp*& {
+      for (auto &lastOp : lastOps) {
+        if (lastOp.first == flag) {
+          return lastOp.second;
+        }
+      }
+      lastOps.emplace_back(flag, nullptr);
+      return lastOps.back().second;
+    };
+    for (Op *op = begin; op != end; ++op) {
+      if (op->kind != OP_COMPONENT) {
+        continue;
+      }
+      compMask flag = op->comp->flag();
+      if (op->comp->hasValue()) {
+        if (after & flag) {
+          continue;
+        }
+        after |= flag;
+        replaced |= before & flag;
+      } else {
+        if ( ! (after & flag)) {
+          continue;
+        }
+        after &= ~flag;
+        replaced &= ~flag;
+      }
+      lastOpFor(flag) = op->comp;
+    }
+    compMask added = after & ~before;
+    compMask removed = before & ~after;
+
+    // If the end result breaks the rules, go one operation at a time so that the failures are the same as usual.
+    bool valid = true;
+    for (auto &lastOp : lastOps) {
+      if (added & lastOp.first) {
+        valid &= hasAll(after, lastOp.second->requiredComps());
+      } else if (removed & lastOp.first) {
+        valid &= ! (lastOp.second->dependentComps() & after);
+      }
+    }
+    if ( ! valid) {
+      for (Op *op = begin; op != end; ++op) {
+        if (op->kind == OP_COMPONENT) {
+          op->comp->apply(state, id);
+        }
+      }
+      return;
+    }
+
+    // Each listener is registered with every type in its likeness, so it is only fired from the list of the lowest
+    // changed type in its likeness, which makes for exactly one notification per listener. A replaced component counts
+    // as a removal and an addition, as it would if it had been removed and added directly, so the notifications are
+    // made as if every removal came first, leaving the entity with only the components in between.
+    compMask taken = removed | replaced;
+    compMask given = added | replaced;
+    compMask between = before & ~taken;
+    for (auto &lastOp : lastOps) {
+      if (taken & lastOp.first) {
+        for (auto &group : lastOp.second->remCallbacks(state)) {
+          if (hasAll(before, group.likeness) && ! hasAll(between, group.likeness) &&
+              lowestFlag(group.likeness & taken) == lastOp.first) {
+            group.fire(id);
+#ifdef EZECS_PROFILING
+            lastOp.second->profile(state).removalFires += group.delegates.size();
+#endif
+          }
+        }
+      }
+    }
+    for (auto &lastOp : lastOps) {
+      if (taken & lastOp.first) {
+        lastOp.second->erase(state, id);
+#ifdef EZECS_PROFILING
+        ++lastOp.second->profile(state).removals;
+#endif
+      }
+      if (given & lastOp.first) {
+        lastOp.second->store(state, id);
+#ifdef EZECS_PROFILING
+        ++lastOp.second->profile(state).additions;
+#endif
+      }
+    }
+    existence = state.comps_Existence.find(id); // looked up again, since delegates may have moved it
+    if ( ! existence) {
+      return;
+    }
+    existence->turnOffFlags(taken);
+    // As with State::addComp, addition delegates see the components in storage before their flags are turned on.
+    for (auto &lastOp : lastOps) {
+      if (given & lastOp.first) {
+        for (auto &group : lastOp.second->addCallbacks(state)) {
+          if (hasAll(after, group.likeness) && ! hasAll(between, group.likeness) &&
+              lowestFlag(group.likeness & given) == lastOp.first) {
+            group.fire(id);
+#ifdef EZECS_PROFILING
+            lastOp.second->profile(state).additionFires += group.delegates.size();
+#endif
+          }
+        }
+      }
+    }
+    existence = state.comps_Existence.find(id);
+    if (existence) {
+      existence->turnOnFlags(given);
+    }
+  }
+}
@@ -0,0 +1,212 @@
+/*
+ * Copyright (c) 2016 Galen Cochrane
+ * Galen Cochrane <galencochrane@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * An EntityCommandBuffer records structural changes (creating and deleting entities, adding and removing components)
+ * so that they can be applied to State later, all at once, at a point where nothing is iterating over State. Recording
+ * is thread-safe, so systems ticked in parallel (see ecsScheduler.hpp) or running parallelForEach can queue up changes
+ * that would otherwise be unsafe for them to make.
+ *
+ * flush() applies everything in one pass, sorted by entity. All of the changes queued for one entity are combined into
+ * a single change of its component mask, so redundant operations cancel out (adding then removing a component does
+ * nothing) and each like-entity listener is notified at most once per entity, or for a component that is removed and
+ * added again, once of the removal and then once of the addition. If the combined change would break a
+ * prerequisite or dependency, that entity's operations are instead applied one by one, exactly as if they had been
+ * called directly on State at flush time.
+ *
+ * EXAMPLE: EntityCommandBuffer commands(state);
+ *          PendingEntity bullet = commands.createEntity();
+ *          commands.add<Position>(bullet, x, y, z);
+ *          commands.rem<Velocity>(someOtherEntity);
+ *          commands.flush(); // at a sync point, such as after Scheduler::tick
+ *          entityId bulletId = commands.resolve(bullet);
+ *
+ * Queued components are kept in a FrameArena (see ecsAllocators.hpp), which flush() releases all at once. There are two
+ * arenas, so that anything recorded by listeners while a flush is under way lands in the other one.
+ */
+
+#pragma once
+
+#include <new>
+#include <mutex>
+#include <optional>
+#include <vector>
+#include "ecsAllocators.hpp"
+#include "ecsState.generated.hpp"
+
+namespace ezecs {
+
+  /*
+   * Stands in for an entity that an EntityCommandBuffer will create when it is flushed
+   */
+  struct PendingEntity {
+    uint32_t index;
+  };
+
+  class EntityCommandBuffer {
+    public:
+      explicit EntityCommandBuffer(State &state);
+      ~EntityCommandBuffer();
+
+      PendingEntity createEntity();
+      void deleteEntity(const entityId &id);
+      void deleteEntity(const PendingEntity &entity);
+
+      /*
+       * Queues a component to be constructed from args (now, on the calling thread) and added when flushed
+       */
+      template<typename compType, typename ... types>
+      void add(const entityId &id, types&& ... args);
+      template<typename compType, typename ... types>
+      void add(const PendingEntity &entity, types&& ... args);
+      template<typename compType>
+      void insert(const entityId &id, compType &&comp);
+      template<typename compType>
+      void insert(const PendingEntity &entity, compType &&comp);
+      template<typename compType>
+      void rem(const entityId &id);
+      template<typename compType>
+      void rem(const PendingEntity &entity);
+
+      /*
+       * Applies every queued operation to State and empties the buffer. Must not be called while other threads are
+       * still recording into this buffer or iterating over State.
+       */
+      void flush();
+
+      /*
+       * Get the ID of an entity created by the most recent flush
+       */
+      entityId resolve(const PendingEntity &entity) const;
+
+      bool empty() const;
+
+    private:
+      /*
+       * The type-specific parts of an operation on a component
+       */
+      struct CompOp {
+        virtual ~CompOp() = default;
+        virtual compMask flag() const = 0;
+        virtual compMask requiredComps() const = 0;
+        virtual compMask dependentComps() const = 0;
+        virtual bool hasValue() const = 0;
+        virtual EntNotifyDelegates &addCallbacks(State &state) const = 0;
+        virtual EntNotifyDelegates &remCallbacks(State &state) const = 0;
+        virtual CompOpReturn apply(State &state, const entityId &id) = 0; // through State's usual checks and callbacks
+        virtual void store(State &state, const entityId &id) = 0; // puts the value in storage with no checks at all
+        virtual void erase(State &state, const entityId &id) = 0;
+#ifdef EZECS_PROFILING
+        virtual CompProfile &profile(State &state) const = 0;
+#endif
+      };
+      template<typename compType>
+      struct TypedCompOp : public CompOp {
+        std::optional<compType> value; // an addition if present, otherwise a removal
+        explicit TypedCompOp(std::optional<compType> &&value) : value(std::move(value)) { }
+        compMask flag() const override { return compType::flag; }
+        compMask requiredComps() const override { return compType::requiredComps; }
+        compMask dependentComps() const override { return compType::dependentComps; }
+        bool hasValue() const override { return value.has_value(); }
+        EntNotifyDelegates &addCallbacks(State &state) const override {
+          return state.addCallbacksOf((compType*) nullptr);
+        }
+        EntNotifyDelegates &remCallbacks(State &state) const override {
+          return state.remCallbacksOf((compType*) nullptr);
+        }
+        CompOpReturn apply(State &state, const entityId &id) override {
+          if (value) {
+            return state.insertOf((compType*) nullptr, id, std::move(*value));
+          }
+          return state.remOf((compType*) nullptr, id);
+        }
+        void store(State &state, const entityId &id) override {
+          state.collectionOf((compType*) nullptr).insert(id, std::move(*value));
+          state.changesOf((compType*) nullptr).mark(id, state.currentTick);
+        }
+        void erase(State &state, const entityId &id) override {
+          state.collectionOf((compType*) nullptr).erase(id);
+        }
+#ifdef EZECS_PROFILING
+        CompProfile &profile(State &state) const override {
+          return state.profileOf<compType>();
+        }
+#endif
+      };
+
+      enum OpKind {
+        OP_CREATE, OP_DELETE, OP_COMPONENT
+      };
+      struct Op {
+        entityId target;  // an entity ID, or the index of a PendingEntity if pending is set
+        bool pending;
+        OpKind kind;
+        CompOp *comp; // constructed in one of the arenas, and destroyed by flush
+      };
+
+      State &state;
+      mutable std::mutex mutex;
+      std::vector<Op> ops;
+      uint32_t numPending = 0;
+      std::vector<entityId> created;
+      FrameArena arenas[2] = { FrameArena(1 << 16), FrameArena(1 << 16) };
+      size_t recordingArena = 0; // the one that ops are currently recorded into
+
+      void record(entityId target, bool pending, OpKind kind);
+      template<typename compType>
+      void recordComp(entityId target, bool pending, std::optional<compType> &&value);
+      static void destroy(std::vector<Op> &ops);
+      void flushEntity(const entityId &id, Op *begin, Op *end);
+  };
+
+  template<typename compType, typename ... types>
+  void EntityCommandBuffer::add(const entityId &id, types&& ... args) {
+    insert<compType>(id, compType(std::forward<types>(args)...));
+  }
+  template<typename compType, typename ... types>
+  void EntityCommandBuffer::add(const PendingEntity &entity, types&& ... args) {
+    insert<compType>(entity, compType(std::forward<types>(args)...));
+  }
+  template<typename compType>
+  void EntityCommandBuffer::insert(const entityId &id, compType &&comp) {
+    recordComp<compType>(id, false, std::move(comp));
+  }
+  template<typename compType>
+  void EntityCommandBuffer::insert(const PendingEntity &entity, compType &&comp) {
+    recordComp<compType>(entity.index, true, std::move(comp));
+  }
+  template<typename compType>
+  void EntityCommandBuffer::rem(const entityId &id) {
+    recordComp<compType>(id, false, std::nullopt);
+  }
+  template<typename compType>
+  void EntityCommandBuffer::rem(const PendingEntity &entity) {
+    recordComp<compType>(entity.index, true, std::nullopt);
+  }
+  template<typename compType>
+  void EntityCommandBuffer::recordComp(entityId target, bool pending, std::optional<compType> &&value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    void *memory = arenas[recordingArena].allocate(sizeof(TypedCompOp<compType>), alignof(TypedCompOp<compType>));
+    ops.push_back(Op{ target, pending, OP_COMPONENT, new (memory) TypedCompOp<compType>(std::move(value)) });
+  }
+}
@@ -24,45 +24,6 @@
 
 namespace ezecs {
 
-  /*
-   * The following fields describe the dependency relationships between components. The 'requiredComps' field of a given
-   * component enumerates which other components (if any) are required for it to exist. For example, it makes no sense
-   * for an entity to posses linear velocity without first having a position. This relationship is important when you're
-   * adding new components to the world. Notice that all components list the existence component as a requirement.
-   *
-   * The 'dependentComps' field describe the inverse relationships, or for a given component, which other components
-   * list it as a required component. This relationship is examined upon the deletion of a component. Notice that
-   * the existence component is a lists 'ALL' (minus itself) as its dependents.
-   *
-   * The generated format for any component enumerator is 'ENUM_[component_type].' ALL and NONE
-   * enumerators also exist. Since these are bit flags, you can probably guess that NONE is zero and ALL is
-   * unsigned -1, or in other words, ALL has all the bits turned on.
-   */
-  
-  template<> compMask Component<Existence>::requiredComps = NONE;
-  template<> compMask Component<Existence>::dependentComps = ALL & ~EXISTENCE;
-  template<> compMask Component<Existence>::flag = EXISTENCE;
-  // COMPONENT DEPENDENCY FIELD DEFINITIONS APPEAR HERE
-  
-  /*
-   * Existence component method definitions
-   */
-  bool Existence::flagIsOn(int compType) {
-    return (compType & componentsPresent) != NONE;
-  }
-  bool Existence::passesPrerequisitesForAddition(compMask requiredComps) {
-    return (requiredComps & componentsPresent) == requiredComps;
-  }
-  bool Existence::passesDependenciesForRemoval(compMask requiredComps) {
-    return (requiredComps & componentsPresent) == NONE;
-  }
-  void Existence::turnOnFlags(compMask mask) {
-    componentsPresent |= mask;
-  }
-  void Existence::turnOffFlags(compMask mask) {
-    componentsPresent &= ~mask;
-  }
-  
   /*
    * The following area is for the definitions of any component methods you create.
    *
@@ -73,22 +34,4 @@ namespace ezecs {
  
   // COMPONENT METHOD DEFINITIONS APPEAR HERE
 
-  /*
-   * compMask getRequiredComps(int compType);
-   * compMask getDependentComps(int compType);
-   */
-  compMask getRequiredComps(int compType) {
-    switch(compType) {
-      case EXISTENCE: return Existence::requiredComps;
-      // COMPONENT REQUIREMENTS GETTER CASES APPEAR HERE
-      default: return ALL;
-    }
-  }
-  compMask getDependentComps(int compType) {
-    switch(compType) {
-      case EXISTENCE: return Existence::dependentComps;
-      // COMPONENT DEPENDENTS GETTER CASES APPEAR HERE
-      default: return ALL;
-    }
-  }
 }
@@ -22,7 +22,9 @@
  */
 #pragma once
 
+#include <type_traits>
 #include "delegate.hpp"
+#include "ecsAllocators.hpp"
 
 // EXTRA INCLUDES APPEAR HERE
 
@@ -63,6 +65,20 @@
  * is cleared. Deletion of such an entity would have to be deliberate and specific. This is useful for data that you
  * want to be saved across all new games, loaded games or other erasures of the ECS, such as the OS window, graphical
  * context, or loaded assets, if it happens that you decide to keep such data in a component.
+ *
+ * Pooled:
+ * For example, EZECS_COMPONENT_ATTRIBS( Projectile, pooled )
+ * A pooled component type is stored using a fixed-size pool allocator (see ecsAllocators.hpp) rather than the default
+ * allocator. This keeps memory from fragmenting in long-running programs that add and remove such components often.
+ * With EZECS_SPARSE_STORAGE, the collection's arrays come from the pools until they outgrow the largest pooled size.
+ * With EZECS_ARCHETYPES, components live in the chunks of their archetypes instead, so this has no effect.
+ *
+ * Raw:
+ * For example, EZECS_COMPONENT_ATTRIBS( Position, raw )
+ * A raw component type is copied in and out of snapshots (see State::writeSnapshot) as plain memory, a whole collection
+ * at a time, instead of through its serialize and deserialize methods. Only use this for types with no pointers,
+ * handles or other state that would not survive being copied byte for byte, such as into another process. The type
+ * must be trivially copyable. Snapshots of raw types can only be read by a program built with the same layout for them.
  */
 #define EZECS_COMPONENT_ATTRIBS( comp, ... )
 
@@ -75,11 +91,11 @@ namespace ezecs {
    */
   struct Existence : public Component<Existence> {
     compMask componentsPresent = 0;
-    bool flagIsOn(int compType);
-    bool passesPrerequisitesForAddition(compMask requiredComps);
-    bool passesDependenciesForRemoval(compMask requiredComps);
-    void turnOnFlags(compMask mask);
-    void turnOffFlags(compMask mask);
+    inline bool flagIsOn(const compMask &compType) const;
+    inline bool passesPrerequisitesForAddition(const compMask &requiredComps) const;
+    inline bool passesDependenciesForRemoval(const compMask &requiredComps) const;
+    inline void turnOnFlags(const compMask &mask);
+    inline void turnOffFlags(const compMask &mask);
   };
 
   /*
@@ -90,6 +106,9 @@ namespace ezecs {
     
   /*
    * Component type/flag enumerator
+   * The generated format for any component enumerator is the type's name in capitals. ALL and NONE enumerators also
+   * exist. Since these are bit flags, you can probably guess that NONE is zero and ALL is unsigned -1, or in other
+   * words, ALL has all the bits turned on.
    */
   enum ComponentTypes {
     NONE =  0,
@@ -99,21 +118,97 @@ namespace ezecs {
   };
 
   /*
+   * With masks wider than 32 bits (see EZECS_MASK_BITS in ecsTypes.hpp), the flags of the component types are compMask
+   * constants defined here rather than enumerators.
    * numCompTypes - how many component types there are, not counting the Existence component type.
    * persistenceMask - which components need to persist through a clearing of the ECS (for whole-program-lifetime data)
+   * serializableMask - which components are sent over the network and saved in snapshots
+   * snapshotSchema - a hash of the serializable components' definitions, which snapshots must match to be loaded
    */
   
   // COMPONENT TYPE COUNTS AND ATTRIBUTE MASKS APPEAR HERE
+
+  /*
+   * The following traits describe the dependency relationships between components. The 'requiredComps' field of a given
+   * component enumerates which other components (if any) are required for it to exist. For example, it makes no sense
+   * for an entity to posses linear velocity without first having a position. This relationship is important when you're
+   * adding new components to the world. Notice that all components list the existence component as a requirement.
+   *
+   * The 'dependentComps' field describe the inverse relationships, or for a given component, which other components
+   * list it as a required component. This relationship is examined upon the deletion of a component. Notice that
+   * the existence component is a lists 'ALL' (minus itself) as its dependents.
+   *
+   * Each type's traits also hold its 'flag', its 'index' (the bit that is its flag), its 'size' and 'alignment', and
+   * whether it is 'serializable', 'persistent' and 'raw'. Since they are all constants, checks against them fold away at
+   * compile time.
+   */
+  template<> struct CompTraits<Existence> {
+    static constexpr const char* name = "Existence";
+    static constexpr compMask flag = EXISTENCE;
+    static constexpr compMask requiredComps = NONE;
+    static constexpr compMask dependentComps = ALL & ~EXISTENCE;
+    static constexpr uint8_t index = 0;
+    static constexpr size_t size = sizeof(Existence);
+    static constexpr size_t alignment = alignof(Existence);
+    static constexpr bool serializable = true;
+    static constexpr bool persistent = false;
+    static constexpr bool raw = true;
+  };
+
+  // COMPONENT TYPE TRAITS AND TYPE LIST APPEAR HERE
+
+  /*
+   * CompTables holds the masks of every type in a CompTypeList, in order, so that they can be looked up by index.
+   */
+  template<typename typeList>
+  struct CompTables;
+  template<typename ... compTypes>
+  struct CompTables<CompTypeList<compTypes...>> {
+    static constexpr compMask requiredComps[] = { CompTraits<compTypes>::requiredComps... };
+    static constexpr compMask dependentComps[] = { CompTraits<compTypes>::dependentComps... };
+  };
   
   /*
-   * Component dependency getter declarations
-   * "getRequiredComps" takes a component type enumerator and returns the set of component types that are prerequisite
+   * Component dependency getters
+   * "getRequiredComps" takes a component type flag and returns the set of component types that are prerequisite
    * for the given type's creation.
    * "getDependentComps" is similar, but instead returns the set of component types for which the given type is a
    * creation-prerequisite.
+   * Both return ALL for anything that is not the flag of exactly one component type.
    */
-  
-  compMask getRequiredComps(int compType);
-  compMask getDependentComps(int compType);
+  constexpr compMask getRequiredComps(const compMask &compType);
+  constexpr compMask getDependentComps(const compMask &compType);
+
+  /*
+   * Existence component method definitions
+   */
+  bool Existence::flagIsOn(const compMask &compType) const {
+    return (compType & componentsPresent) != NONE;
+  }
+  bool Existence::passesPrerequisitesForAddition(const compMask &requiredComps) const {
+    return hasAll(componentsPresent, requiredComps);
+  }
+  bool Existence::passesDependenciesForRemoval(const compMask &requiredComps) const {
+    return (requiredComps & componentsPresent) == NONE;
+  }
+  void Existence::turnOnFlags(const compMask &mask) {
+    componentsPresent |= mask;
+  }
+  void Existence::turnOffFlags(const compMask &mask) {
+    componentsPresent &= ~mask;
+  }
+
+  constexpr compMask getRequiredComps(const compMask &compType) {
+    if ( ! compType || lowestFlag(compType) != compType || flagIndex(compType) >= AllCompTypes::size) {
+      return ALL;
+    }
+    return CompTables<AllCompTypes>::requiredComps[flagIndex(compType)];
+  }
+  constexpr compMask getDependentComps(const compMask &compType) {
+    if ( ! compType || lowestFlag(compType) != compType || flagIndex(compType) >= AllCompTypes::size) {
+      return ALL;
+    }
+    return CompTables<AllCompTypes>::dependentComps[flagIndex(compType)];
+  }
 
 }
@@ -29,18 +29,22 @@
  * IN THE SOFTWARE.
  */
 /*
- * TODO: Dependency cycle detection
- * Currently, component dependency cycles will result in infinite loops in this code
+ * Component dependency cycles are detected while the teardown order is worked out, which happens before anything else
+ * walks the dependencies in order. The generator then lists the types in the cycle and exits with -25.
  */
 
+#include <cstdint>
+#include <cstdlib>
 #include <cstring>
 #include <sstream>
 #include <fstream>
-#include <regex>
 #include <iostream>
+#include <set>
 #include <vector>
 #include <unordered_map>
+#include <algorithm>
 #include <iomanip>
+#include <chrono>
 
 using namespace std;
 
@@ -51,9 +55,28 @@ const char *slash = "\\";
 const char *slash = "/";
 #endif
 
+/*
+ * The configuration files are read by scanConfig, which splits each into tokens in one pass, skipping comments and
+ * literals, and finds the BEGIN/END section markers along the way. Each token knows which section it came from.
+ */
+enum ConfigSection { OUTSIDE_SECTIONS, INCLUDES_SECTION, DECLARATIONS_SECTION, DEFINITIONS_SECTION };
+struct ConfigToken {
+  string text;
+  size_t begin, end; // offsets into the configuration file's text
+  ConfigSection section;
+};
+struct ScannedConfig {
+  string includes, decls, defns;
+  vector<ConfigToken> tokens;
+};
+int scanConfig(const string &config, ScannedConfig &scanned);
+bool parseMacroArgs(const vector<ConfigToken> &tokens, size_t &i, vector<string> &args);
+
 struct CompAttribs {
 	bool persistent = false;
 	bool serializable = true;
+	bool pooled = false;
+	bool raw = false;
 };
 
 // Prototype helper methods
@@ -69,7 +92,9 @@ string getPtrsFromArgList(const string &argList);
 string getNullPtrsFromArgList(const string &argList);
 string getAddrsFromNameList(const string &nameList);
 string getDerefsFromNameList(const string &nameList);
-string replaceAndCount(const string& inStr, const regex& rx, const string& reStr, uint_fast32_t & numLines);
+string substitutePlaceholders(const string &templ, const vector<pair<string, string>> &codes, uint_fast32_t &numLines);
+uint64_t fnv1a(const string &str, uint64_t hash = 0xcbf29ce484222325ull);
+bool writeIfChanged(const string &fileName, const string &contents, uint_fast32_t &numWritten);
 /*
  * CompType holds everything we need to know about a component type in order to generate all the associated code.
  */
@@ -97,9 +122,16 @@ struct CompType {
 
 /*
  * main is called by CMake
- * It takes an input directory, an output directory, and 1 or more configuration files
+ * It takes an input directory, an output directory, and 1 or more configuration files. The per-type State methods are
+ * split over a number of ecsState.<n>.generated.cpp units, which can be set with a "--units=<n>" argument (default 1).
+ * The width of component masks is 32 bits unless set to 128 or 256 with "--mask-bits=<n>", which must match the
+ * EZECS_MASK_BITS the code is compiled with (see ecsTypes.hpp).
+ * Generated files are only written when their contents change, and when nothing that went into them has changed
+ * (according to the hash in ecsGenerated.stamp), nothing is generated at all. Either way, the stamp gets touched.
  */
 int main(int argc, char *argv[]) {
+  auto startTime = chrono::steady_clock::now();
+
   // CMake should provide 3 or more arguments after the command name (so 4 or more total).
   if (argc < 4) {
     cerr << "ecsGenerator: Did not receive correct number of arguments." << endl;
@@ -109,8 +141,27 @@ int main(int argc, char *argv[]) {
   // set up all file names for reading and writing
   string srcDir = argv[1];
   string binDir = argv[2];
-  vector<string> fileNames_configsIn(argc - 3);
-  for (uint_fast32_t i = 3; i < (uint_fast32_t)argc; ++i) { fileNames_configsIn[i - 3] = argv[i]; }  
+  vector<string> fileNames_configsIn;
+  uint_fast32_t numUnits = 1;
+  uint_fast32_t maskBits = 32;
+  for (uint_fast32_t i = 3; i < (uint_fast32_t)argc; ++i) {
+    string arg = argv[i];
+    if (arg.compare(0, 8, "--units=") == 0) {
+      numUnits = max(1, atoi(arg.c_str() + 8));
+    } else if (arg.compare(0, 12, "--mask-bits=") == 0) {
+      maskBits = atoi(arg.c_str() + 12);
+      if (maskBits != 32 && maskBits != 128 && maskBits != 256) {
+        cerr << "ecsGenerator: Mask width must be 32, 128 or 256 bits (got " << arg << ")." << endl;
+        return -1;
+      }
+    } else {
+      fileNames_configsIn.push_back(arg);
+    }
+  }
+  if (fileNames_configsIn.empty()) {
+    cerr << "ecsGenerator: Did not receive any configuration files." << endl;
+    return -1;
+  }
   string fileName_compsHIn = srcDir + slash + "ecsComponents.hpp";
   string fileName_compsCIn = srcDir + slash + "ecsComponents.cpp";
   string fileName_compsHOut = binDir + slash + "ecsComponents.generated.hpp";
@@ -119,6 +170,12 @@ int main(int argc, char *argv[]) {
   string fileName_stateCIn = srcDir + slash + "ecsState.cpp";
   string fileName_stateHOut = binDir + slash + "ecsState.generated.hpp";
   string fileName_stateCOut = binDir + slash + "ecsState.generated.cpp";
+  string fileName_unitCIn = srcDir + slash + "ecsStateUnit.cpp";
+  vector<string> fileNames_unitCOut(numUnits);
+  for (uint_fast32_t u = 0; u < numUnits; ++u) {
+    fileNames_unitCOut[u] = binDir + slash + "ecsState." + to_string(u) + ".generated.cpp";
+  }
+  string fileName_stamp = binDir + slash + "ecsGenerated.stamp";
 
   // read in and store all input files (next five sections of code)
   vector<string> str_configsIn;
@@ -160,113 +217,75 @@ int main(int argc, char *argv[]) {
   string str_stateCIn(ss_stateCIn.str());
   stateCIn.close();
 
+  ifstream unitCIn(fileName_unitCIn);
+  if (!unitCIn) { return -21; }
+  stringstream ss_unitCIn;
+  ss_unitCIn << unitCIn.rdbuf();
+  string str_unitCIn(ss_unitCIn.str());
+  unitCIn.close();
+
   /*
-   * codes_includes will be filled with the include directives from the config files
-   * codes_confDecls will be filled with the component declarations from the config files
-   * codes_confDefns will be filled with the component definitions from the config files
+   * Hash everything the output depends on: the inputs, the arguments, and the generator itself (if it can be found).
+   * If that matches the stamp left by the last run and all of the outputs are still there, there is nothing to do.
    */
-  vector<string> codes_includes(str_configsIn.size());
-  vector<string> codes_confDecls(str_configsIn.size());
-  vector<string> codes_confDefns(str_configsIn.size());
+  uint64_t inputHash = fnv1a(to_string(numUnits) + " " + to_string(maskBits));
+  for (uint_fast32_t i = 0; i < fileNames_configsIn.size(); ++i) {
+    inputHash = fnv1a(str_configsIn[i], fnv1a(fileNames_configsIn[i], inputHash));
+  }
+  for (const string *str : { &str_compsHIn, &str_compsCIn, &str_stateHIn, &str_stateCIn, &str_unitCIn }) {
+    inputHash = fnv1a(*str, inputHash);
+  }
+  ifstream generatorIn(argv[0], ios::binary);
+  if (generatorIn) {
+    stringstream ss_generatorIn;
+    ss_generatorIn << generatorIn.rdbuf();
+    inputHash = fnv1a(ss_generatorIn.str(), inputHash);
+  } else {
+    inputHash = fnv1a(to_string(chrono::system_clock::now().time_since_epoch().count()), inputHash); // can't skip
+  }
+  stringstream ss_stamp;
+  ss_stamp << hex << setw(16) << setfill('0') << inputHash << endl;
+  string str_stamp = ss_stamp.str();
+  bool upToDate = false;
+  ifstream stampIn(fileName_stamp);
+  if (stampIn) {
+    stringstream ss_stampIn;
+    ss_stampIn << stampIn.rdbuf();
+    upToDate = ss_stampIn.str() == str_stamp;
+    stampIn.close();
+  }
+  vector<string> fileNames_out = { fileName_compsHOut, fileName_compsCOut, fileName_stateHOut, fileName_stateCOut };
+  fileNames_out.insert(fileNames_out.end(), fileNames_unitCOut.begin(), fileNames_unitCOut.end());
+  for (const auto &fileName : fileNames_out) {
+    upToDate = upToDate && ifstream(fileName).good();
+  }
+  if (upToDate) {
+    ofstream stampOut(fileName_stamp, ios::trunc);
+    if (!stampOut) { return -23; }
+    stampOut << str_stamp;
+    stampOut.close();
+    cout << "GENERATED CODE IS UP TO DATE (" << chrono::duration_cast<chrono::microseconds>(
+        chrono::steady_clock::now() - startTime).count() << " us)" << endl;
+    return 0;
+  }
 
+  // Scan every config file once, which finds its sections and splits it into tokens
+  vector<ScannedConfig> scannedConfigs(str_configsIn.size());
   for (uint_fast32_t i = 0; i < str_configsIn.size(); ++i) {
-	  // Get the entire block of code comprising the include directives
-	  regex rx_confCodeInclBegin(R"(\/\/\s*BEGIN\s*INCLUDES\s*)");
-	  const char *confIn = str_configsIn[i].c_str();
-	  auto rxit = cregex_iterator(confIn, confIn + strlen(confIn), rx_confCodeInclBegin);
-	  if (rxit != cregex_iterator()) {
-		  cmatch match = *rxit;
-		  codes_includes[i] = str_configsIn[i].substr((size_t)match.position() + match.length(), str_configsIn[i].length());
-	  } else {
-		  cerr << "Parsing provided ezecs config file: Could not identify comment '// BEGIN INCLUDES' :"
-		       << " Make sure that comment exists and is formatted and placed correctly." << endl;
-		  return -7;
-	  }
-
-	  // Get just the declarations section of the config file code
-	  regex rx_confCodeInclEnd(R"(\s*\/\/\s*END\s*INCLUDES)");
-	  const char* confIncludes = codes_includes[i].c_str();
-	  rxit = cregex_iterator(confIncludes, confIncludes + strlen(confIncludes), rx_confCodeInclEnd);
-	  if (rxit != cregex_iterator()) {
-		  cmatch match = *rxit;
-		  codes_includes[i] = codes_includes[i].substr(0, (size_t)match.position());
-	  } else {
-		  cerr << "Parsing provided ezecs config file: Could not identify comment '// END INCLUDES' :"
-		       << " Make sure that comment exists and is formatted and placed correctly." << endl;
-		  return -8;
-	  }
-	  
-	  // Get the entire block of code comprising the component declarations and definitions from the config file
-	  string code_confAll;
-	  regex rx_confCodeAll(R"(\/\/\s*BEGIN\s*DECLARATIONS\s*)");
-	  rxit = cregex_iterator(confIn, confIn + strlen(confIn), rx_confCodeAll);
-	  if (rxit != cregex_iterator()) {
-		  cmatch match = *rxit;
-		  code_confAll = str_configsIn[i].substr((size_t)match.position() + match.length(), str_configsIn[i].length());
-	  } else {
-		  cerr << "Parsing provided ezecs config file: Could not identify comment '// BEGIN DECLARATIONS' :"
-		       << " Make sure that comment exists and is formatted and placed correctly." << endl;
-		  return -7;
-	  }
-
-	  // Get just the declarations section of the config file code
-	  regex rx_confCodeEndDecl(R"(\s*\/\/\s*END\s*DECLARATIONS)");
-	  const char* confDecls = code_confAll.c_str();
-	  rxit = cregex_iterator(confDecls, confDecls + strlen(confDecls), rx_confCodeEndDecl);
-	  if (rxit != cregex_iterator()) {
-		  cmatch match = *rxit;
-		  codes_confDecls[i] = code_confAll.substr(0, (size_t)match.position());
-	  } else {
-		  cerr << "Parsing provided ezecs config file: Could not identify comment '// END DECLARATIONS' :"
-		       << " Make sure that comment exists and is formatted and placed correctly." << endl;
-		  return -8;
-	  }
-	  
-	  // Get just the definitions section of the config file code (then cut off the trailing unrelated code)
-	  string code_confDefnsDirty;
-	  regex rx_confCodeBegDefn(R"(\/\/\s*BEGIN\s*DEFINITIONS\s*)");
-	  rxit = cregex_iterator(confDecls, confDecls + strlen(confDecls), rx_confCodeBegDefn);
-	  if (rxit != cregex_iterator()) {
-		  cmatch match = *rxit;
-		  code_confDefnsDirty = code_confAll.substr((size_t)match.position() + match.length(), code_confAll.length());
-	  } else {
-		  cerr << "Parsing provided ezecs config file: Could not identify comment '// BEGIN DEFINITIONS' :"
-		       << " Make sure that comment exists and is formatted and placed correctly." << endl;
-		  return -9;
-	  }
-	  regex rx_confCodeEndDefn(R"(\s*\/\/\s*END\s*DEFINITIONS)");
-	  const char* confDefnsDirty = code_confDefnsDirty.c_str();
-	  rxit = cregex_iterator(confDefnsDirty, confDefnsDirty + strlen(confDefnsDirty), rx_confCodeEndDefn);
-	  if (rxit != cregex_iterator()) {
-		  cmatch match = *rxit;
-		  codes_confDefns[i] = code_confDefnsDirty.substr(0, (size_t)match.position());
-	  } else {
-		  cerr << "Parsing provided ezecs config file: Could not identify comment '// END DEFINITIONS' :"
-		       << " Make sure that comment exists and is formatted and placed correctly." << endl;
-		  return -10;
-	  }
+    int error = scanConfig(str_configsIn[i], scannedConfigs[i]);
+    if (error) { return error; }
   }
-  
+
   // add all the results from the different configuration files together
-  stringstream all_confs, all_includes, all_compDecls, all_compDefns;
+  stringstream all_includes, all_compDecls, all_compDefns;
 	for (uint_fast32_t i = 0; i < str_configsIn.size(); ++i) {
-		all_confs << (i ? "\n\n" : "") << str_configsIn[i];
-		all_includes << (i ? "\n\n" : "") << codes_includes[i];
-		all_compDecls << (i ? "\n\n  " : "") << codes_confDecls[i];
-		all_compDefns << (i ? "\n\n  " : "") << codes_confDefns[i];
+		all_includes << (i ? "\n\n" : "") << scannedConfigs[i].includes;
+		all_compDecls << (i ? "\n\n  " : "") << scannedConfigs[i].decls;
+		all_compDefns << (i ? "\n\n  " : "") << scannedConfigs[i].defns;
 	}
-	
-	/*
-   * String and C-string versions of the above strings we just found
-   */
-	string sconfs = all_confs.str();
 	string sincls = all_includes.str();
 	string sdecls = all_compDecls.str();
 	string sdefns = all_compDefns.str();
-	const char* confs = sconfs.c_str();
-	const char* incls = sincls.c_str();
-	const char* decls = sdecls.c_str();
-	const char* defns = sdefns.c_str();
 	
   /*
    * compTypes will have keys that are component type names and values that are CompType (component type descriptions)
@@ -275,80 +294,91 @@ int main(int argc, char *argv[]) {
   unordered_map<string, CompType> compTypes;
   vector<string> compTypeNames;
 
-  // Fill compTypes' 'name' fields with the user's component type names from the config file.
-  regex rx_confCompDecls(R"((?:class|struct)\s*(\w*)\s*:\s*public\s*Component\s*<\s*\w*\s*>)");
-  for (auto it = cregex_iterator(decls, decls + strlen(decls), rx_confCompDecls); it != cregex_iterator(); ++it) {
-    cmatch match = *it;
-    CompType newType;
-    newType.name = match[1].str();
-    compTypes[match[1].str()] = newType;
-    compTypeNames.push_back(match[1].str());
+  /*
+   * Walk the tokens of every config file once, picking out:
+   *   component declarations ("struct Name : public Component<Name>") in the DECLARATIONS sections,
+   *   EZECS_COMPONENT_DEPENDENCIES and EZECS_COMPONENT_ATTRIBS uses anywhere, and
+   *   the first constructor definition ("Name::Name(...)") of each type in the DEFINITIONS sections.
+   * Macro uses and constructors may refer to types declared later, so they are resolved afterwards.
+   */
+  vector<vector<string>> depMacros, attribMacros;
+  unordered_map<string, string> ctorArgsByName;
+  for (uint_fast32_t c = 0; c < scannedConfigs.size(); ++c) {
+    const string &config = str_configsIn[c];
+    const vector<ConfigToken> &toks = scannedConfigs[c].tokens;
+    auto is = [&toks](size_t i, const char *text) { return i < toks.size() && toks[i].text == text; };
+    for (size_t i = 0; i < toks.size(); ++i) {
+      if ((is(i, "struct") || is(i, "class")) && toks[i].section == DECLARATIONS_SECTION &&
+          i + 7 < toks.size() && is(i + 2, ":") && is(i + 3, "public") && is(i + 4, "Component") && is(i + 5, "<") &&
+          is(i + 7, ">")) {
+        const string &name = toks[i + 1].text;
+        if ( ! compTypes.count(name)) {
+          compTypeNames.push_back(name);
+        }
+        compTypes[name].name = name;
+        i += 7;
+      } else if ((is(i, "EZECS_COMPONENT_DEPENDENCIES") || is(i, "EZECS_COMPONENT_ATTRIBS")) && is(i + 1, "(")) {
+        vector<string> args;
+        bool isDeps = is(i, "EZECS_COMPONENT_DEPENDENCIES");
+        ++i;
+        if (parseMacroArgs(toks, i, args)) {
+          (isDeps ? depMacros : attribMacros).push_back(args);
+        }
+      } else if (toks[i].section == DEFINITIONS_SECTION && is(i + 1, "::") && i + 3 < toks.size() &&
+                 toks[i + 2].text == toks[i].text && is(i + 3, "(")) {
+        size_t open = i + 3, close = open;
+        for (int depth = 0; close < toks.size(); ++close) {
+          depth += toks[close].text == "(" ? 1 : toks[close].text == ")" ? -1 : 0;
+          if ( ! depth) { break; }
+        }
+        if (close < toks.size() && ! ctorArgsByName.count(toks[i].text)) {
+          string args = config.substr(toks[open].end, toks[close].begin - toks[open].end);
+          size_t first = args.find_first_not_of(" \t\r\n"), last = args.find_last_not_of(" \t\r\n");
+          ctorArgsByName[toks[i].text] = first == string::npos ? "" : args.substr(first, last - first + 1);
+        }
+        i = close;
+      }
+    }
   }
 
   // Fill compTypes' 'prerequisiteComps' fields given the user's calls to the EZECS_COMPONENT_DEPENDENCIES macro
-  regex rx_confCompDep(R"(EZECS_COMPONENT_DEPENDENCIES\s*\((\s*\w*(?:\s*,\s*\w+\s*)*\s*)\))");
-  for (auto it = cregex_iterator(confs, confs + strlen(confs), rx_confCompDep); it != cregex_iterator(); ++it) {
-    cmatch match = *it;
-    stringstream ss_depArgs(match[1].str());
-    CompType* compType = nullptr;
-    string token;
-    bool first = true;
-    while(getline(ss_depArgs, token, ',')) {
-      token.erase( // remove whitespaces from string
-          remove_if( token.begin(), token.end(), []( char ch ) {
-            return isspace<char>( ch, locale::classic() );
-          } ), token.end() );
-      if (first) {
-        first = false;
-        try {
-          compType = &compTypes.at(token);
-        } catch (...) {
-          cerr << "Invalid use of EZECS_COMPONENT_DEPENDENCIES (invalid first arg given: '" << token << "')" << endl;
-          return -12;
-        }
+  for (const auto &args : depMacros) {
+    if ( ! compTypes.count(args[0])) {
+      cerr << "Invalid use of EZECS_COMPONENT_DEPENDENCIES (invalid first arg given: '" << args[0] << "')" << endl;
+      return -12;
+    }
+    CompType* compType = &compTypes.at(args[0]);
+    for (size_t a = 1; a < args.size(); ++a) {
+      if (compTypes.count(args[a])) {
+        compType->prerequisiteComps.push_back(args[a]);
       } else {
-        if (compTypes.count(token)) {
-          compType->prerequisiteComps.push_back(token);
-        } else {
-          cerr << "Invalid use of EZECS_COMPONENT_DEPENDENCIES (first arg: '" << compType->name
-               << "'. invalid arg given: '" << token << "'.)" << endl;
-          return -13;
-        }
+        cerr << "Invalid use of EZECS_COMPONENT_DEPENDENCIES (first arg: '" << compType->name
+             << "'. invalid arg given: '" << args[a] << "'.)" << endl;
+        return -13;
       }
     }
   }
 
-	// Fill compTypes' 'attribs.persistent' fields given the user's calls to the EZECS_COMPONENT_PERSISTENCE macro
-	regex rx_confCompAttribs(R"(EZECS_COMPONENT_ATTRIBS\s*\((\s*\w*(?:\s*,\s*\w+\s*)*\s*)\))");
-	for (auto it = cregex_iterator(confs, confs + strlen(confs), rx_confCompAttribs); it != cregex_iterator(); ++it) {
-		cmatch match = *it;
-		stringstream ss_depArgs(match[1].str());
-		CompType* compType = nullptr;
-		string token;
-		bool first = true;
-		while(getline(ss_depArgs, token, ',')) {
-			token.erase( // remove whitespaces from string
-						remove_if( token.begin(), token.end(), []( char ch ) {
-							return isspace<char>( ch, locale::classic() );
-						} ), token.end() );
-			if (first) {
-				first = false;
-				try {
-					compType = &compTypes.at(token);
-				} catch (...) {
-					cerr << "Invalid use of EZECS_COMPONENT_ATTRIBS (invalid first arg given: '" << token << "')" << endl;
-					return -14;
-				}
+	// Fill compTypes' 'attribs' fields given the user's calls to the EZECS_COMPONENT_ATTRIBS macro
+	for (const auto &args : attribMacros) {
+		if ( ! compTypes.count(args[0])) {
+			cerr << "Invalid use of EZECS_COMPONENT_ATTRIBS (invalid first arg given: '" << args[0] << "')" << endl;
+			return -14;
+		}
+		CompType* compType = &compTypes.at(args[0]);
+		for (size_t a = 1; a < args.size(); ++a) {
+			if (args[a] == "persistent") {
+				compType->attribs.persistent = true;
+			} else if (args[a] == "noserialize") {
+				compType->attribs.serializable = false;
+			} else if (args[a] == "pooled") {
+				compType->attribs.pooled = true;
+			} else if (args[a] == "raw") {
+				compType->attribs.raw = true;
 			} else {
-				if (token == "persistent") {
-					compType->attribs.persistent = true;
-				} else if (token == "noserialize") {
-					compType->attribs.serializable = false;
-				} else {
-					cerr << "Invalid use of EZECS_COMPONENT_ATTRIBS (first arg: '" << compType->name
-					     << "'. invalid arg given: '" << token << "'.)" << endl;
-					return -15;
-				}
+				cerr << "Invalid use of EZECS_COMPONENT_ATTRIBS (first arg: '" << compType->name
+				     << "'. invalid arg given: '" << args[a] << "'.)" << endl;
+				return -15;
 			}
 		}
 	}
@@ -362,14 +392,8 @@ int main(int argc, char *argv[]) {
 
 	// Fill out compTypes' constructorArgs fields using those names, and then fill all the fields we can at this point.
 	for (const auto &name : compTypeNames) {
-		stringstream regexBuilder;
-		regexBuilder << name << R"(\s*::\s*)" << name;
-		regexBuilder << R"(\s*\(\s*(.*)\s*\))";
-		regex rx_confCompCnstrctr(regexBuilder.str());
-		auto it = cregex_iterator(defns, defns + strlen(defns), rx_confCompCnstrctr);
-		if (it != cregex_iterator()) {
-			cmatch match = *it;
-			compTypes.at(name).ctorArgs = match[1].str();
+		if (ctorArgsByName.count(name)) {
+			compTypes.at(name).ctorArgs = ctorArgsByName.at(name);
 			compTypes.at(name).resolveSimpleStrings();
 		} else {
 			cerr << "Could not find constructor definition for " << name <<"! Make sure there is an explicit definition "
@@ -378,17 +402,36 @@ int main(int argc, char *argv[]) {
 		}
 	}
 
-  // Build the string that goes in the component enumerators spot
-  stringstream ss_code_compEnum;
+  // Every type needs a bit, besides Existence and MAX_COMPONENT_ENUM
+  if (compTypeNames.size() + 2 > maskBits) {
+    cerr << "Too many component types (" << compTypeNames.size() << ") for " << maskBits << "-bit masks! ";
+    if (maskBits < 256) { cerr << "Set EZECS_MASK_BITS to " << (maskBits < 128 ? "128" : "256") << "." << endl; }
+    else { cerr << "No more than " << maskBits - 2 << " are supported." << endl; }
+    return -24;
+  }
+
+  // Build the string that goes in the component enumerators spot. Flags past 32 bits can't be enumerators, so wide
+  // masks get constants instead, which go with the attribute masks below.
+  stringstream ss_code_compEnum, ss_code_compFlags;
   int i = 0;
   for (const auto &name : compTypeNames) {
-    ss_code_compEnum << TAB TAB << compTypes.at(name).enumName << " = 1 << " << ++i << "," << endl;
+    if (maskBits > 32) {
+      ss_code_compFlags << TAB "constexpr compMask " << compTypes.at(name).enumName << " = compMask::bit(" << ++i
+                        << ");" << endl;
+    } else {
+      ss_code_compEnum << TAB TAB << compTypes.at(name).enumName << " = 1 << " << ++i << "," << endl;
+    }
+  }
+  if (maskBits > 32) {
+    ss_code_compFlags << TAB "constexpr compMask MAX_COMPONENT_ENUM = compMask::bit(" << ++i << ");" << endl;
+  } else {
+    ss_code_compEnum << TAB TAB << "MAX_COMPONENT_ENUM = 1 << " << ++i << endl;
   }
-  ss_code_compEnum << TAB TAB << "MAX_COMPONENT_ENUM = 1 << " << ++i << endl;
   string code_compEnum = ss_code_compEnum.str();
 
   // Build the string that declares the number of user-made components
   stringstream ss_code_numComps;
+  ss_code_numComps << ss_code_compFlags.str();
   ss_code_numComps << TAB "constexpr uint8_t numCompTypes = " << i << ";" << endl;
   string code_numComps = ss_code_numComps.str();
   
@@ -401,10 +444,28 @@ int main(int argc, char *argv[]) {
   	}
   }
   ss_code_compAttrMasks << ";" << endl;
+  ss_code_compAttrMasks << TAB "constexpr compMask serializableMask = EXISTENCE";
+  uint64_t snapshotSchema = fnv1a(to_string(compTypeNames.size()));
+  for (const auto &name : compTypeNames) {
+    if (compTypes.at(name).attribs.serializable) {
+      ss_code_compAttrMasks << " | " << compTypes.at(name).enumName;
+      snapshotSchema = fnv1a(name + "(" + compTypes.at(name).ctorArgs + ")", snapshotSchema);
+    }
+  }
+  ss_code_compAttrMasks << ";" << endl;
+  ss_code_compAttrMasks << TAB "constexpr uint64_t snapshotSchema = 0x" << hex << snapshotSchema << dec << "ull;" << endl;
+  for (const auto &name : compTypeNames) {
+    if (compTypes.at(name).attribs.pooled) {
+      ss_code_compAttrMasks << TAB "template<> struct KvMapAllocator<" << name << "> { typedef PoolAllocator<" << name
+                            << "> type; };" << endl;
+    }
+  }
   string code_compAttrMasks = ss_code_compAttrMasks.str();
 
-  // Build the string that defines the component dependency relationships
-  stringstream ss_code_compDepends;
+  // Build the string that defines each component type's traits (its name, flag, dependency relationships, index, size,
+  // alignment and attributes), followed by the list of all of the types in the order of their flags
+  stringstream ss_code_compTraits;
+  int index = 0;
   for (const auto &name : compTypeNames) {
     // required comps
     string requiredComps;
@@ -414,8 +475,6 @@ int main(int argc, char *argv[]) {
       ss_requiredComps << " | " << compTypes.at(comp).enumName;
     }
     requiredComps = ss_requiredComps.str();
-    ss_code_compDepends << endl << TAB "template<> compMask Component<" << name << ">::requiredComps = "
-                        << requiredComps << ";" << endl;
 
     // dependent comps
     string dependentComps;
@@ -429,26 +488,65 @@ int main(int argc, char *argv[]) {
       }
       dependentComps = ss_dependentComps.str();
     }
-    ss_code_compDepends << TAB "template<> compMask Component<" << name << ">::dependentComps = "
-                        << dependentComps << ";" << endl;
 
-    // self flag
-    ss_code_compDepends << TAB "template<> compMask Component<" << name << ">::flag = "
-                        << compTypes.at(name).enumName << ";" << endl;
+    const CompAttribs &attribs = compTypes.at(name).attribs;
+    ss_code_compTraits << TAB "template<> struct CompTraits<" << name << "> {" << endl;
+    ss_code_compTraits << TAB TAB "static constexpr const char* name = \"" << name << "\";" << endl;
+    ss_code_compTraits << TAB TAB "static constexpr compMask flag = " << compTypes.at(name).enumName << ";" << endl;
+    ss_code_compTraits << TAB TAB "static constexpr compMask requiredComps = " << requiredComps << ";" << endl;
+    ss_code_compTraits << TAB TAB "static constexpr compMask dependentComps = " << dependentComps << ";" << endl;
+    ss_code_compTraits << TAB TAB "static constexpr uint8_t index = " << ++index << ";" << endl;
+    ss_code_compTraits << TAB TAB "static constexpr size_t size = sizeof(" << name << ");" << endl;
+    ss_code_compTraits << TAB TAB "static constexpr size_t alignment = alignof(" << name << ");" << endl;
+    ss_code_compTraits << TAB TAB "static constexpr bool serializable = " << (attribs.serializable ? "true" : "false")
+                       << ";" << endl;
+    ss_code_compTraits << TAB TAB "static constexpr bool persistent = " << (attribs.persistent ? "true" : "false")
+                       << ";" << endl;
+    ss_code_compTraits << TAB TAB "static constexpr bool raw = " << (attribs.raw ? "true" : "false") << ";" << endl;
+    if (attribs.raw) {
+      ss_code_compTraits << TAB TAB "static_assert(std::is_trivially_copyable<" << name << ">::value, \"" << name
+                         << " is raw, so it must be trivially copyable\");" << endl;
+    }
+    ss_code_compTraits << TAB "};" << endl;
   }
-  string code_compDepends = ss_code_compDepends.str();
-
-  // Build the strings that are used in the component dependency getter switch-case statements
-  stringstream ss_code_compGetReq;
-  stringstream ss_code_compGetDep;
+  ss_code_compTraits << TAB "typedef CompTypeList<Existence";
   for (const auto &name : compTypeNames) {
-    ss_code_compGetReq << TAB TAB TAB "case " << compTypes.at(name).enumName << ": return "
-                       << name << "::requiredComps;" << endl;
-    ss_code_compGetDep << TAB TAB TAB "case " << compTypes.at(name).enumName << ": return "
-                       << name << "::dependentComps;" << endl;
+    ss_code_compTraits << ", " << name;
   }
-  string code_compGetReq = ss_code_compGetReq.str();
-  string code_compGetDep = ss_code_compGetDep.str();
+  ss_code_compTraits << "> AllCompTypes;" << endl;
+
+  // Entities are torn down in the reverse of an order in which every type comes after its prerequisites, so that
+  // nothing is removed while something that depends on it is still there
+  vector<string> topologicalOrder;
+  set<string> ordered;
+  while (topologicalOrder.size() < compTypeNames.size()) {
+    size_t before = topologicalOrder.size();
+    for (const auto &name : compTypeNames) {
+      if (ordered.count(name)) { continue; }
+      bool preqsOrdered = true;
+      for (const auto &preq : compTypes.at(name).prerequisiteComps) {
+        preqsOrdered = preqsOrdered && ordered.count(preq);
+      }
+      if (preqsOrdered) {
+        topologicalOrder.push_back(name);
+        ordered.insert(name);
+      }
+    }
+    if (topologicalOrder.size() == before) {
+      cerr << "Component dependencies are circular! None of the remaining types can come first:";
+      for (const auto &name : compTypeNames) {
+        if ( ! ordered.count(name)) { cerr << " " << name; }
+      }
+      cerr << endl;
+      return -25;
+    }
+  }
+  ss_code_compTraits << TAB "typedef CompTypeList<";
+  for (auto name = topologicalOrder.rbegin(); name != topologicalOrder.rend(); ++name) {
+    ss_code_compTraits << (name == topologicalOrder.rbegin() ? "" : ", ") << *name;
+  }
+  ss_code_compTraits << "> TeardownOrder;" << endl;
+  string code_compTraits = ss_code_compTraits.str();
 
   // Build the string that declares collections, methods, and stuff in ecsState.generated.hpp
   stringstream ss_code_stateHOut;
@@ -490,95 +588,107 @@ int main(int argc, char *argv[]) {
   }
 	string code_srlAll = ss_code_srlAll.str();
 
-  // Build a string for the stuff in the 'clear all components' loop
-  stringstream ss_code_clearCompLoop;
+  // Build a string for the body of serializeDelta, which replicates every serializable type that has any data
+  stringstream ss_code_replAll;
   for (const auto &name : compTypeNames) {
-    string enm = compTypes.at(name).enumName;
-    ss_code_clearCompLoop
-        << TAB TAB "remCompNoChecks(comps_" << name << ", existence, id, remCallbacks_" << name << ");" << endl;
+    if (compTypes.at(name).attribs.serializable && ! compTypes.at(name).ctorArgs.empty()) {
+      ss_code_replAll << TAB TAB "complete &= replicate" << name << "(rw, stream, since, relevant);" << endl;
+    }
   }
-  string code_clearCompLoop = ss_code_clearCompLoop.str();
+  string code_replAll = ss_code_replAll.str();
 
-  // Build a string for the entity likeness callback registration
-  stringstream ss_code_cllbkReg;
+  // Build strings for the bodies of serializeSnapshotComps and fireSnapshotCallbacks, which cover every serializable
+  // type. Each type's block is tagged with a hash of its name and constructor arguments.
+  stringstream ss_code_snapAll, ss_code_snapCllbks;
+  for (const auto &name : compTypeNames) {
+    if (compTypes.at(name).attribs.serializable) {
+      ss_code_snapAll << TAB TAB "ok = ok && snapshotComps<" << name << ", "
+                      << (compTypes.at(name).ctorArgs.empty() ? "false" : "true") << ">(rw, stream, start, 0x" << hex
+                      << fnv1a(name + "(" + compTypes.at(name).ctorArgs + ")") << dec << "ull, excluded);" << endl;
+      ss_code_snapCllbks << TAB TAB "fireSnapshotCallbacks<" << name << ">(ids, existences);" << endl;
+    }
+  }
+  string code_snapAll = ss_code_snapAll.str();
+  string code_snapCllbks = ss_code_snapCllbks.str();
+
+  // Build strings for the entity likeness callback registration and unregistration
+  stringstream ss_code_cllbkReg, ss_code_cllbkUnreg;
   for (const auto &name : compTypeNames) {
     ss_code_cllbkReg << TAB TAB "if (likeness & " << compTypes.at(name).enumName << ") {" << endl;
     ss_code_cllbkReg << TAB TAB TAB "registerAddCallback" << name << "(additionDelegate);" << endl;
     ss_code_cllbkReg << TAB TAB TAB "registerRemCallback" << name << "(removalDelegate);" << endl;
     ss_code_cllbkReg << TAB TAB "}" << endl;
+    ss_code_cllbkUnreg << TAB TAB "if (likeness & " << compTypes.at(name).enumName << ") {" << endl;
+    ss_code_cllbkUnreg << TAB TAB TAB "addCallbacks_" << name << ".remove(handle);" << endl;
+    ss_code_cllbkUnreg << TAB TAB TAB "remCallbacks_" << name << ".remove(handle);" << endl;
+    ss_code_cllbkUnreg << TAB TAB "}" << endl;
   }
   string code_cllbkReg = ss_code_cllbkReg.str();
+  string code_cllbkUnreg = ss_code_cllbkUnreg.str();
 
-  // Build a string for the collection manipulation methods
-  stringstream ss_code_compCollDefns;
+  // Build a string for the collection manipulation methods of each unit. Types are hashed into units by name only, so
+  // adding or removing a type leaves the others where they were.
+  vector<stringstream> ss_code_compCollDefns(numUnits);
   for (const auto &name : compTypeNames) {
-    ss_code_compCollDefns << compTypes.at(name).stateC << endl;
+    ss_code_compCollDefns[fnv1a(name) % numUnits] << compTypes.at(name).stateC << endl;
   }
-  string code_compCollDefns = ss_code_compCollDefns.str();
 
   // keep count of lines generated
   uint_fast32_t lineCount = 0;
 
-  // replace "appears here" comments in the input file strings with code (next four sections)
-  regex rx_compIncls(R"([ \t]*\/\/ EXTRA INCLUDES APPEAR HERE)");
-  regex rx_compDecls(R"([ \t]*\/\/ COMPONENT DECLARATIONS APPEAR HERE)");
-  regex rx_compEnums(R"([ \t]*\/\/ COMPONENT TYPE ENUMERATORS APPEAR HERE)");
-  regex rx_compCntAndAttrs(R"([ \t]*\/\/ COMPONENT TYPE COUNTS AND ATTRIBUTE MASKS APPEAR HERE)");
-	string str_compsHOut = replaceAndCount(str_compsHIn, rx_compIncls, sincls, lineCount);
-	str_compsHOut = replaceAndCount(str_compsHOut, rx_compDecls, TAB + sdecls, lineCount);
-  str_compsHOut = replaceAndCount(str_compsHOut, rx_compEnums, code_compEnum, lineCount);
-  str_compsHOut = replaceAndCount(str_compsHOut, rx_compCntAndAttrs, code_numComps + code_compAttrMasks, lineCount);
-
-  regex rx_compDepDef(R"([ \t]*\/\/ COMPONENT DEPENDENCY FIELD DEFINITIONS APPEAR HERE)");
-  regex rx_compMetDef(R"([ \t]*\/\/ COMPONENT METHOD DEFINITIONS APPEAR HERE)");
-  regex rx_compGetReqDef(R"([ \t]*\/\/ COMPONENT REQUIREMENTS GETTER CASES APPEAR HERE)");
-  regex rx_compGetDepDef(R"([ \t]*\/\/ COMPONENT DEPENDENTS GETTER CASES APPEAR HERE)");
-  string str_compsCOut = replaceAndCount(str_compsCIn, rx_compDepDef, code_compDepends, lineCount);
-  str_compsCOut = replaceAndCount(str_compsCOut, rx_compMetDef, TAB + sdefns, lineCount);
-  str_compsCOut = replaceAndCount(str_compsCOut, rx_compGetReqDef, code_compGetReq, lineCount);
-  str_compsCOut = replaceAndCount(str_compsCOut, rx_compGetDepDef, code_compGetDep, lineCount);
-
-  regex rx_compCollDecls(R"(      \/\/ COMPONENT COLLECTION AND MANIPULATION METHOD DECLARATIONS APPEAR HERE)");
-  string str_stateHOut = replaceAndCount(str_stateHIn, rx_compCollDecls, code_stateHOut, lineCount);
-
-	regex rx_compSrlAll(R"([ \t]*\/\/ SERIALIZE COMPONENT CREATION REQUEST DEFINITION BODY APPEARS HERE)");
-  regex rx_compClrLoop(R"([ \t]*\/\/ A LOOP TO CLEAR ALL COMPONENTS APPEARS HERE)");
-  regex rx_compRegCllbks(R"([ \t]*\/\/ CODE TO REGISTER THE APPROPRIATE CALLBACKS APPEARS HERE)");
-  regex rx_compCollDef(R"([ \t]*\/\/ COMPONENT COLLECTION MANIPULATION METHOD DEFINITIONS APPEAR HERE)");
-  string str_stateCOut = replaceAndCount(str_stateCIn, rx_compSrlAll, code_srlAll, lineCount);
-  str_stateCOut = replaceAndCount(str_stateCOut, rx_compClrLoop, code_clearCompLoop, lineCount);
-  str_stateCOut = replaceAndCount(str_stateCOut, rx_compRegCllbks, code_cllbkReg, lineCount);
-  str_stateCOut = replaceAndCount(str_stateCOut, rx_compCollDef, code_compCollDefns, lineCount);
+  // replace "appears here" comments in the input file strings with code, one pass over each file
+	string str_compsHOut = substitutePlaceholders(str_compsHIn, {
+	    { "EXTRA INCLUDES APPEAR HERE", sincls },
+	    { "COMPONENT DECLARATIONS APPEAR HERE", TAB + sdecls },
+	    { "COMPONENT TYPE ENUMERATORS APPEAR HERE", code_compEnum },
+	    { "COMPONENT TYPE COUNTS AND ATTRIBUTE MASKS APPEAR HERE", code_numComps + code_compAttrMasks },
+	    { "COMPONENT TYPE TRAITS AND TYPE LIST APPEAR HERE", code_compTraits } }, lineCount);
+
+  string str_compsCOut = substitutePlaceholders(str_compsCIn, {
+      { "COMPONENT METHOD DEFINITIONS APPEAR HERE", TAB + sdefns } }, lineCount);
+
+  string str_stateHOut = substitutePlaceholders(str_stateHIn, {
+      { "COMPONENT COLLECTION AND MANIPULATION METHOD DECLARATIONS APPEAR HERE", code_stateHOut } }, lineCount);
+
+  string str_stateCOut = substitutePlaceholders(str_stateCIn, {
+      { "SERIALIZE COMPONENT CREATION REQUEST DEFINITION BODY APPEARS HERE", code_srlAll },
+      { "REPLICATE EACH CHANGED COMPONENT TYPE APPEARS HERE", code_replAll },
+      { "SNAPSHOT EACH SERIALIZABLE COMPONENT COLLECTION APPEARS HERE", code_snapAll },
+      { "FIRE SNAPSHOT CALLBACKS FOR EACH SERIALIZABLE COMPONENT TYPE APPEARS HERE", code_snapCllbks },
+      { "CODE TO REGISTER THE APPROPRIATE CALLBACKS APPEARS HERE", code_cllbkReg },
+      { "CODE TO UNREGISTER THE APPROPRIATE CALLBACKS APPEARS HERE", code_cllbkUnreg } }, lineCount);
+
+  vector<string> str_unitCOut(numUnits);
+  for (uint_fast32_t u = 0; u < numUnits; ++u) {
+    str_unitCOut[u] = substitutePlaceholders(str_unitCIn, {
+        { "COMPONENT COLLECTION MANIPULATION METHOD DEFINITIONS APPEAR HERE", ss_code_compCollDefns[u].str() } },
+        lineCount);
+  }
 
   // make some file header intro text for header and source files (next two sections)
   stringstream ss_hIntro;
-  ss_hIntro << "/*\n * EZECS - The E-Z Entity Component System\n * Header generated using " << argv[3] << "\n */\n\n";
+  ss_hIntro << "/*\n * EZECS - The E-Z Entity Component System\n * Header generated using " << fileNames_configsIn[0] << "\n */\n\n";
   string hppIntro = ss_hIntro.str();
 
   stringstream ss_cIntro;
-  ss_cIntro << "/*\n * EZECS - The E-Z Entity Component System\n * Source generated using " << argv[3] << "\n */\n\n";
+  ss_cIntro << "/*\n * EZECS - The E-Z Entity Component System\n * Source generated using " << fileNames_configsIn[0] << "\n */\n\n";
   string cppIntro = ss_cIntro.str();
 
-  // write the output file strings to the appropriate files (next four sections of code)
-  ofstream compsHOut(fileName_compsHOut);
-  if (!compsHOut) { return -16; }
-  compsHOut << hppIntro << str_compsHOut;
-  compsHOut.close();
-
-  ofstream compsCOut(fileName_compsCOut);
-  if (!compsCOut) { return -17; }
-  compsCOut << cppIntro << str_compsCOut;
-  compsCOut.close();
-
-  ofstream stateHOut(fileName_stateHOut);
-  if (!stateHOut) { return -18; }
-  stateHOut << hppIntro << str_stateHOut;
-  stateHOut.close();
+  // write the output file strings to the appropriate files, leaving alone any that would not change (so that the build
+  // system does not recompile them), and then the stamp
+  uint_fast32_t numWritten = 0;
+  if (!writeIfChanged(fileName_compsHOut, hppIntro + str_compsHOut, numWritten)) { return -16; }
+  if (!writeIfChanged(fileName_compsCOut, cppIntro + str_compsCOut, numWritten)) { return -17; }
+  if (!writeIfChanged(fileName_stateHOut, hppIntro + str_stateHOut, numWritten)) { return -18; }
+  if (!writeIfChanged(fileName_stateCOut, cppIntro + str_stateCOut, numWritten)) { return -19; }
+  for (uint_fast32_t u = 0; u < numUnits; ++u) {
+    if (!writeIfChanged(fileNames_unitCOut[u], cppIntro + str_unitCOut[u], numWritten)) { return -22; }
+  }
 
-  ofstream stateCOut(fileName_stateCOut);
-  if (!stateCOut) { return -19; }
-  stateCOut << cppIntro << str_stateCOut;
-  stateCOut.close();
+  ofstream stampOut(fileName_stamp, ios::trunc);
+  if (!stampOut) { return -23; }
+  stampOut << str_stamp;
+  stampOut.close();
 
   // Give some feedback
   for (const auto &name : compTypeNames) {
@@ -586,6 +696,8 @@ int main(int argc, char *argv[]) {
     colName << left << name << " [" << compTypes.at(name).enumName << "]";
 	  colAttr << (compTypes.at(name).attribs.serializable ? "s" : "");
     colAttr << (compTypes.at(name).attribs.persistent ? "p" : "");
+    colAttr << (compTypes.at(name).attribs.pooled ? "o" : "");
+    colAttr << (compTypes.at(name).attribs.raw ? "r" : "");
     colReq << "REQ(";
     for (const auto &preq : compTypes.at(name).prerequisiteComps) {
       colReq << preq << (preq == compTypes.at(name).prerequisiteComps.back() ? "" : ", ");
@@ -604,8 +716,11 @@ int main(int argc, char *argv[]) {
     // cout << setw(40) << left << colCtor.str();
     cout << endl;
   }
-  // report lines generated
+  // report lines generated and how long it took
   cout << "LINES OF CODE GENERATED: " << lineCount << endl;
+  cout << "FILES CHANGED: " << numWritten << " OF " << fileNames_out.size() << endl;
+  cout << "GENERATED IN " << chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - startTime).count()
+       << " us" << endl;
 
   return 0;
 }
@@ -625,9 +740,23 @@ string enumStringIzer(const string& compType) {
  */
 string genStateHPrivatSection(const string &compType) {
   stringstream result;
-  result << TAB TAB TAB "KvMap<entityId, " << compType << "> comps_" << compType << ";" << endl;
-  result << TAB TAB TAB "std::vector<EntNotifyDelegate> addCallbacks_" << compType << ";" << endl;
-  result << TAB TAB TAB "std::vector<EntNotifyDelegate> remCallbacks_" << compType << ";" << endl;
+  result << TAB TAB TAB "CompCollection<" << compType << "> comps_" << compType << " = makeCollection<" << compType
+         << ">();" << endl;
+  result << TAB TAB TAB "EntNotifyDelegates addCallbacks_" << compType << ";" << endl;
+  result << TAB TAB TAB "EntNotifyDelegates remCallbacks_" << compType << ";" << endl;
+  result << TAB TAB TAB "ChangeTracker changes_" << compType << ";" << endl;
+  result << TAB TAB TAB "CompCollection<" << compType << ">& collectionOf(" << compType << "*) { return comps_"
+         << compType << "; }" << endl;
+  result << TAB TAB TAB "ChangeTracker& changesOf(" << compType << "*) { return changes_" << compType << "; }"
+         << endl;
+  result << TAB TAB TAB "EntNotifyDelegates& addCallbacksOf(" << compType << "*) { return addCallbacks_"
+         << compType << "; }" << endl;
+  result << TAB TAB TAB "EntNotifyDelegates& remCallbacksOf(" << compType << "*) { return remCallbacks_"
+         << compType << "; }" << endl;
+  result << TAB TAB TAB "CompOpReturn insertOf(" << compType << "*, const entityId &id, " << compType
+         << " &&comp) { return insert" << compType << "(id, std::move(comp)); }" << endl;
+  result << TAB TAB TAB "CompOpReturn remOf(" << compType << "*, const entityId &id) { return rem" << compType
+         << "(id); }" << endl;
   return result.str();
 }
 
@@ -640,10 +769,15 @@ string genStateHPublicSection(const string &compType, const string &compArgs, co
   stringstream result;
   result << TAB TAB TAB "CompOpReturn add" << compType << "(const entityId &id"
          << (compArgs.empty() ? "" : ", " + compArgs) << ");" << endl;
+  result << TAB TAB TAB "CompOpReturn add" << compType << "Bulk(std::span<const entityId> ids"
+         << (compArgs.empty() ? "" : ", " + compArgs) << ");" << endl;
   result << TAB TAB TAB "CompOpReturn insert" << compType << "(const entityId &id, " << compType << " &&comp);" << endl;
   result << TAB TAB TAB "CompOpReturn rem" << compType << "(const entityId &id);" << endl;
   result << TAB TAB TAB "CompOpReturn get" << compType << "(const entityId &id, " << compType << "** out);" << endl;
   result << TAB TAB TAB << compType << "& get" << compType << "(const entityId &id);" << endl;
+  result << TAB TAB TAB "CompOpReturn get" << compType << "Mut(const entityId &id, " << compType << "** out);"
+         << endl;
+  result << TAB TAB TAB << compType << "& get" << compType << "Mut(const entityId &id);" << endl;
   result << TAB TAB TAB "void registerAddCallback" << compType << "(EntNotifyDelegate &dlgt);" << endl;
   result << TAB TAB TAB "void registerRemCallback" << compType << "(EntNotifyDelegate &dlgt);" << endl;
   if ( ! attribs.serializable) { return result.str(); }
@@ -651,6 +785,11 @@ string genStateHPublicSection(const string &compType, const string &compArgs, co
 	result << TAB TAB TAB "void serialize" << compType << "(bool rw, SLNet::BitStream *stream, const entityId &id"
 	       << ", std::vector<std::unique_ptr<SLNet::BitStream>> *compStreams = nullptr"
 	       << (compArgPtrs.empty() ? "" : ", " + compArgPtrs) << ");" << endl;
+  if ( ! compArgs.empty()) {
+    result << TAB TAB TAB "bool replicate" << compType << "(bool rw, SLNet::BitStream &stream, const changeTick &since,"
+           << endl;
+    result << TAB TAB TAB TAB TAB "const std::unordered_set<entityId> *relevant = nullptr);" << endl;
+  }
   return result.str();
 }
 
@@ -669,6 +808,12 @@ string genStateCDefns(const string &compType, const string &compArgs, const stri
          << (compArgs.empty() ? "" : ", " + compArgNames) << ");" << endl;
   result << TAB "}" << endl;
 
+  result << TAB "CompOpReturn State::add" << compType << "Bulk(std::span<const entityId> ids"
+         << (compArgs.empty() ? "" : ", " + compArgs) << ") {" << endl;
+  result << TAB TAB "return addCompBulk(comps_" << compType << ", ids, addCallbacks_" << compType
+         << (compArgs.empty() ? "" : ", " + compArgNames) << ");" << endl;
+  result << TAB "}" << endl;
+
 	result << TAB "CompOpReturn State::insert" << compType << "(const entityId &id, " << compType << " &&comp) {" << endl;
 	result << TAB TAB "return insertComp(comps_" << compType << ", id, addCallbacks_" << compType
 	       << ", std::forward<" << compType << ">(comp));" << endl;
@@ -687,6 +832,21 @@ string genStateCDefns(const string &compType, const string &compArgs, const stri
 	result << TAB TAB "EZECS_VERBOSE_FATAL(get" << compType << "(id, &comp))" << endl;
 	result << TAB TAB "return *comp;" << endl;
 	result << TAB "}" << endl;
+
+  result << TAB "CompOpReturn State::get" << compType << "Mut(const entityId &id, " << compType << "** out) {"
+         << endl;
+  result << TAB TAB "CompOpReturn status = getComp(comps_" << compType << ", id, out);" << endl;
+  result << TAB TAB "if (status == SUCCESS) {" << endl;
+  result << TAB TAB TAB "changes_" << compType << ".mark(id, currentTick);" << endl;
+  result << TAB TAB "}" << endl;
+  result << TAB TAB "return status;" << endl;
+  result << TAB "}" << endl;
+
+  result << TAB << compType << "& State::get" << compType << "Mut(const entityId &id) {" << endl;
+  result << TAB TAB << compType << " *comp;" << endl;
+  result << TAB TAB "EZECS_VERBOSE_FATAL(get" << compType << "Mut(id, &comp))" << endl;
+  result << TAB TAB "return *comp;" << endl;
+  result << TAB "}" << endl;
   
   result << TAB "void State::registerAddCallback" << compType << "(EntNotifyDelegate &dlgt) {" << endl;
   result << TAB TAB "addCallbacks_" << compType << ".push_back(dlgt);" << endl;
@@ -751,7 +911,43 @@ string genStateCDefns(const string &compType, const string &compArgs, const stri
 	}
 	
 	result << TAB "}" << endl;
-	
+
+  if (compArgs.empty()) { return result.str(); } // nothing to replicate besides the component's existence
+
+  result << TAB "bool State::replicate" << compType << "(bool rw, SLNet::BitStream &stream, const changeTick &since,"
+         << endl;
+  result << TAB TAB TAB "const std::unordered_set<entityId> *relevant) {" << endl;
+  result << TAB TAB "uint32_t count = 0;" << endl;
+  result << TAB TAB "bool complete = true;" << endl;
+  result << TAB TAB "if (rw) {" << endl;
+  result << TAB TAB TAB "for (auto &&pair : comps_" << compType << ") {" << endl;
+  result << TAB TAB TAB TAB "count += needsReplication(changes_" << compType << ", pair.first, since, relevant);" << endl;
+  result << TAB TAB TAB "}" << endl;
+  result << TAB TAB TAB "stream.WriteCompressed(count);" << endl;
+  result << TAB TAB TAB "for (auto &&pair : comps_" << compType << ") {" << endl;
+  result << TAB TAB TAB TAB "if (needsReplication(changes_" << compType << ", pair.first, since, relevant)) {" << endl;
+  result << TAB TAB TAB TAB TAB "stream.Write(pair.first);" << endl;
+  result << TAB TAB TAB TAB TAB "pair.second.serialize(stream);" << endl;
+  result << TAB TAB TAB TAB "}" << endl;
+  result << TAB TAB TAB "}" << endl;
+  result << TAB TAB "} else {" << endl;
+  result << TAB TAB TAB "stream.ReadCompressed(count);" << endl;
+  result << TAB TAB TAB "for (uint32_t i = 0; i < count; ++i) {" << endl;
+  result << TAB TAB TAB TAB "entityId id = 0;" << endl;
+  result << TAB TAB TAB TAB "stream.Read(id);" << endl;
+  result << TAB TAB TAB TAB << compType << " update = " << compType << "::deserialize(stream);" << endl;
+  result << TAB TAB TAB TAB << compType << " *comp;" << endl;
+  result << TAB TAB TAB TAB "if (getComp(comps_" << compType << ", id, &comp) == SUCCESS) {" << endl;
+  result << TAB TAB TAB TAB TAB "*comp = std::move(update);" << endl;
+  result << TAB TAB TAB TAB TAB "changes_" << compType << ".mark(id, currentTick);" << endl;
+  result << TAB TAB TAB TAB "} else { // added since the entity was created, unless the entity is not created here yet" << endl;
+  result << TAB TAB TAB TAB TAB "complete &= insert" << compType << "(id, std::move(update)) != NONEXISTENT_ENT;" << endl;
+  result << TAB TAB TAB TAB "}" << endl;
+  result << TAB TAB TAB "}" << endl;
+  result << TAB TAB "}" << endl;
+  result << TAB TAB "return complete;" << endl;
+  result << TAB "}" << endl;
+
   return result.str();
 }
 
@@ -845,11 +1041,176 @@ string getDerefsFromNameList(const string &nameList) {
 }
 
 /*
- * A helper to keep track of how many lines of code have been inserted using regex_replace
+ * A 64-bit FNV-1a hash, used to tag generated data formats with the component definitions that they were made from
  */
-string replaceAndCount(const string& inStr, const regex& rx, const string& reStr, uint_fast32_t & numLines) {
-	numLines += (uint_fast32_t) count(reStr.begin(), reStr.end(), '\n');
-  return regex_replace(inStr, rx, reStr);
+uint64_t fnv1a(const string &str, uint64_t hash) {
+  for (unsigned char c : str) {
+    hash = (hash ^ c) * 0x100000001b3ull;
+  }
+  return hash;
+}
+
+/*
+ * Writes contents to the named file unless the file already holds exactly that, in which case its modification time
+ * is left alone too. Returns false if the file could not be written.
+ */
+bool writeIfChanged(const string &fileName, const string &contents, uint_fast32_t &numWritten) {
+  ifstream existingIn(fileName);
+  if (existingIn) {
+    stringstream ss_existingIn;
+    ss_existingIn << existingIn.rdbuf();
+    if (ss_existingIn.str() == contents) {
+      return true;
+    }
+    existingIn.close();
+  }
+  ofstream out(fileName, ios::trunc);
+  if (!out) { return false; }
+  out << contents;
+  ++numWritten;
+  return true;
+}
+
+/*
+ * Splits a configuration file into tokens (identifiers, numbers, "::" and single punctuation characters) in one pass,
+ * skipping whitespace, comments and string and character literals. The section marker comments (such as
+ * "// BEGIN DECLARATIONS") are found along the way, and the text of each section is cut out of the file.
+ * Returns 0, or the generator's error code if a marker is missing.
+ */
+int scanConfig(const string &config, ScannedConfig &scanned) {
+  enum { BEGIN_INCLUDES, END_INCLUDES, BEGIN_DECLARATIONS, END_DECLARATIONS, BEGIN_DEFINITIONS, END_DEFINITIONS };
+  const char *markerNames[] = { "BEGIN INCLUDES", "END INCLUDES", "BEGIN DECLARATIONS", "END DECLARATIONS",
+                                "BEGIN DEFINITIONS", "END DEFINITIONS" };
+  const int errorCodes[] = { -7, -8, -7, -8, -9, -10 };
+  size_t markers[6];
+  fill(markers, markers + 6, string::npos);
+  ConfigSection section = OUTSIDE_SECTIONS;
+  size_t n = config.size(), i = 0;
+  auto isWordChar = [](char ch) { return isalnum((unsigned char) ch) || ch == '_'; };
+  while (i < n) {
+    char ch = config[i];
+    if (isspace((unsigned char) ch)) {
+      ++i;
+    } else if (ch == '/' && i + 1 < n && config[i + 1] == '/') {
+      // A line comment, which may be a marker: "//", then "BEGIN" or "END", then the section's name
+      size_t commentStart = i, j = i + 2;
+      string words[2];
+      for (auto &word : words) {
+        while (j < n && (config[j] == ' ' || config[j] == '\t')) { ++j; }
+        while (j < n && isWordChar(config[j])) { word += config[j++]; }
+      }
+      int marker = -1;
+      for (int m = 0; m < 6; ++m) {
+        if (words[0] + " " + words[1] == markerNames[m]) { marker = m; }
+      }
+      bool isEnd = marker % 2 == 1;
+      if (marker >= 0 && markers[marker] == string::npos && ( ! isEnd || markers[marker - 1] != string::npos) &&
+          (marker != BEGIN_DEFINITIONS || markers[BEGIN_DECLARATIONS] != string::npos)) {
+        if (isEnd) { // the section ends before the whitespace leading up to its end marker
+          size_t sectionEnd = commentStart;
+          while (sectionEnd > markers[marker - 1] && isspace((unsigned char) config[sectionEnd - 1])) { --sectionEnd; }
+          markers[marker] = sectionEnd;
+          section = OUTSIDE_SECTIONS;
+        } else { // the section starts after its begin marker and any whitespace following it
+          size_t sectionBegin = j;
+          while (sectionBegin < n && isspace((unsigned char) config[sectionBegin])) { ++sectionBegin; }
+          markers[marker] = sectionBegin;
+          section = marker == BEGIN_INCLUDES ? INCLUDES_SECTION :
+                    marker == BEGIN_DECLARATIONS ? DECLARATIONS_SECTION : DEFINITIONS_SECTION;
+        }
+      }
+      while (i < n && config[i] != '\n') { ++i; }
+    } else if (ch == '/' && i + 1 < n && config[i + 1] == '*') {
+      size_t close = config.find("*/", i + 2);
+      i = close == string::npos ? n : close + 2;
+    } else if (ch == '"' || ch == '\'') {
+      for (++i; i < n && config[i] != ch; ++i) {
+        if (config[i] == '\\') { ++i; }
+      }
+      ++i;
+    } else if (isWordChar(ch)) {
+      size_t begin = i;
+      while (i < n && isWordChar(config[i])) { ++i; }
+      if (i < n && config[i] == '"' && config[i - 1] == 'R') { // a raw string literal: R"delim( ... )delim"
+        size_t open = config.find('(', i);
+        string close = ")" + config.substr(i + 1, open == string::npos ? 0 : open - i - 1) + "\"";
+        size_t found = open == string::npos ? string::npos : config.find(close, open);
+        i = found == string::npos ? n : found + close.size();
+        continue;
+      }
+      scanned.tokens.push_back({ config.substr(begin, i - begin), begin, i, section });
+    } else {
+      size_t width = ch == ':' && i + 1 < n && config[i + 1] == ':' ? 2 : 1;
+      scanned.tokens.push_back({ config.substr(i, width), i, i + width, section });
+      i += width;
+    }
+  }
+  for (int m = 0; m < 6; ++m) {
+    if (markers[m] == string::npos) {
+      cerr << "Parsing provided ezecs config file: Could not identify comment '// " << markerNames[m] << "' :"
+           << " Make sure that comment exists and is formatted and placed correctly." << endl;
+      return errorCodes[m];
+    }
+  }
+  scanned.includes = config.substr(markers[BEGIN_INCLUDES], markers[END_INCLUDES] - markers[BEGIN_INCLUDES]);
+  scanned.decls = config.substr(markers[BEGIN_DECLARATIONS], markers[END_DECLARATIONS] - markers[BEGIN_DECLARATIONS]);
+  scanned.defns = config.substr(markers[BEGIN_DEFINITIONS], markers[END_DEFINITIONS] - markers[BEGIN_DEFINITIONS]);
+  return 0;
+}
+
+/*
+ * Given the index of the opening parenthesis of a macro use, collects its comma-separated names into args and leaves
+ * i at the closing parenthesis. Returns false if the arguments are not a list of names.
+ */
+bool parseMacroArgs(const vector<ConfigToken> &tokens, size_t &i, vector<string> &args) {
+  bool expectName = true;
+  for (++i; i < tokens.size() && tokens[i].text != ")"; ++i) {
+    const string &text = tokens[i].text;
+    if (expectName && (isalpha((unsigned char) text[0]) || text[0] == '_')) {
+      args.push_back(text);
+    } else if (expectName || text != ",") {
+      return false;
+    }
+    expectName = ! expectName;
+  }
+  if (args.empty()) {
+    args.push_back(""); // reported as an invalid first argument
+  }
+  return i < tokens.size();
+}
+
+/*
+ * Replaces each line of templ that holds one of the given placeholder comments (such as "// EXTRA INCLUDES APPEAR HERE")
+ * with its code, in one pass over templ. Keeps track of how many lines of code have been inserted.
+ */
+string substitutePlaceholders(const string &templ, const vector<pair<string, string>> &codes, uint_fast32_t &numLines) {
+  for (const auto &code : codes) {
+    numLines += (uint_fast32_t) count(code.second.begin(), code.second.end(), '\n');
+  }
+  string result;
+  result.reserve(templ.size());
+  size_t lineStart = 0;
+  while (lineStart < templ.size()) {
+    size_t lineEnd = templ.find('\n', lineStart);
+    lineEnd = lineEnd == string::npos ? templ.size() : lineEnd + 1;
+    size_t text = templ.find_first_not_of(" \t", lineStart);
+    bool replaced = false;
+    if (text < lineEnd && templ.compare(text, 3, "// ") == 0) {
+      for (const auto &code : codes) {
+        if (templ.compare(text + 3, code.first.size(), code.first) == 0) {
+          result += code.second;
+          result.append(templ, text + 3 + code.first.size(), lineEnd - (text + 3 + code.first.size()));
+          replaced = true;
+          break;
+        }
+      }
+    }
+    if ( ! replaced) {
+      result.append(templ, lineStart, lineEnd - lineStart);
+    }
+    lineStart = lineEnd;
+  }
+  return result;
 }
 
 #undef TAB
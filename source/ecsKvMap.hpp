@@ -22,25 +22,46 @@
  */
 
 /*
- * Wrapper class for whatever implementation of a hash map I wish to use.
- * Right now, I'm using std::unordered_map from C++ standard library.
+ * Wrapper class for whatever implementation of a map I wish to use.
+ * If EZECS_SPARSE_STORAGE is defined (see the CMake option of the same name), a sparse set is used so that values are
+ * packed contiguously and looked up by array indexing (see ecsSparseSet.hpp). Otherwise (the default), I'm using
+ * std::unordered_map from C++ standard library, which never moves a value once it is in the map.
  */
 
 #pragma once
 
+#include <algorithm>
 #include <unordered_map>
+#include "ecsAllocators.hpp"
+#include "ecsSparseSet.hpp"
+#include "ecsMemory.hpp"
 
 namespace ezecs {
 
-  template<class K, class V>
+#ifdef EZECS_SPARSE_STORAGE
+  template<class K, class V, class Alloc>
+  using KvMapImpl = SparseSet<K, V, Alloc>;
+#else
+  template<class K, class V, class Alloc>
+  using KvMapImpl = std::unordered_map<K, V, std::hash<K>, std::equal_to<K>,
+      typename std::allocator_traits<Alloc>::template rebind_alloc<std::pair<const K, V>>>;
+#endif
+
+  /*
+   * Alloc is an allocator of V, which is rebound to whatever the internal map actually allocates. By default it is
+   * chosen by KvMapAllocator (see ecsAllocators.hpp).
+   */
+  template<class K, class V, class Alloc = typename KvMapAllocator<V>::type>
   class KvMap {
     private:
-      std::unordered_map<K, V> internalMap;
+      KvMapImpl<K, V, Alloc> internalMap;
 
     public:
       KvMap();
       ~KvMap();
       V &at(const K &key);
+      V *find(const K &key);
+      const V *find(const K &key) const;
       V& operator [] (const K& key);
       V& operator [] (K&& key);
       void clear() noexcept;
@@ -57,84 +78,178 @@ namespace ezecs {
 		  bool insert(std::pair<K, V>&& pair);
 		  bool insert(K&& k, V&& v);
 		  bool insert(const K& k, V&& v);
+
+		  /*
+		   * Moves count values in at once, skipping any whose key is already present or repeated earlier in the batch.
+		   * Returns how many were inserted.
+		   */
+		  size_t insertBulk(const K* keys, V* values, size_t count);
 		  
       bool erase(const K &key);
       void reserve(std::size_t n);
       size_t count(const K &key) const;
-      typedef typename std::unordered_map<K, V>::const_iterator const_iterator;
+      size_t size() const;
+      typedef typename KvMapImpl<K, V, Alloc>::iterator iterator;
+      typedef typename KvMapImpl<K, V, Alloc>::const_iterator const_iterator;
+      iterator begin();
+      iterator end();
       const_iterator begin() const;
       const_iterator end() const;
+
+      /*
+       * With EZECS_SPARSE_STORAGE the usage is exact. Otherwise it is an estimate that counts a key and a link per node
+       * and a pointer per hash bucket, with the buckets beyond one per value as slack.
+       */
+      MemoryUsage memoryUsage() const;
+
+      /*
+       * Releases memory that is held but not used, such as after many removals. Pointers to values may be invalidated.
+       */
+      void shrinkToFit();
+#ifdef EZECS_SPARSE_STORAGE
+      /*
+       * The keys and values, each packed contiguously in the same order, size() of them
+       */
+      const K* keyData() const;
+      V* valueData();
+#endif
   };
 
-  template<class K, class V>
-  KvMap<K, V>::KvMap() { }
-  template<class K, class V>
-  KvMap<K, V>::~KvMap() { }
-  template<class K, class V>
-  V &KvMap<K, V>::at(const K &key) {
+  template<class K, class V, class Alloc>
+  KvMap<K, V, Alloc>::KvMap() { }
+  template<class K, class V, class Alloc>
+  KvMap<K, V, Alloc>::~KvMap() { }
+  template<class K, class V, class Alloc>
+  V &KvMap<K, V, Alloc>::at(const K &key) {
     return internalMap.at(key);
   }
-  template<class K, class V>
-  V& KvMap<K, V>::operator [] (const K& key) {
+  template<class K, class V, class Alloc>
+  V *KvMap<K, V, Alloc>::find(const K &key) {
+    auto it = internalMap.find(key);
+    return it == internalMap.end() ? nullptr : &it->second;
+  }
+  template<class K, class V, class Alloc>
+  const V *KvMap<K, V, Alloc>::find(const K &key) const {
+    return const_cast<KvMap*>(this)->find(key);
+  }
+  template<class K, class V, class Alloc>
+  V& KvMap<K, V, Alloc>::operator [] (const K& key) {
     return internalMap[key];
   }
-  template<class K, class V>
-  V& KvMap<K, V>::operator [] (K&& key) {
+  template<class K, class V, class Alloc>
+  V& KvMap<K, V, Alloc>::operator [] (K&& key) {
     return internalMap[key];
   }
-  template<class K, class V>
-  void KvMap<K, V>::clear() noexcept {
+  template<class K, class V, class Alloc>
+  void KvMap<K, V, Alloc>::clear() noexcept {
     internalMap.clear();
   }
-  template<class K, class V>
-  bool KvMap<K, V>::contains(const K &key) const {
+  template<class K, class V, class Alloc>
+  bool KvMap<K, V, Alloc>::contains(const K &key) const {
     return (bool) internalMap.count(key);
   }
-  template<class K, class V>
+  template<class K, class V, class Alloc>
   template<class... Args>
-  bool KvMap<K, V>::emplace(Args &&... args) {
+  bool KvMap<K, V, Alloc>::emplace(Args &&... args) {
     return internalMap.emplace(std::forward<Args>(args)...).second;
   }
-  template<class K, class V>
+  template<class K, class V, class Alloc>
   template <class... Args>
-  bool KvMap<K, V>::try_emplace(K&& k, Args&&... args) {
+  bool KvMap<K, V, Alloc>::try_emplace(K&& k, Args&&... args) {
   	return internalMap.try_emplace(std::forward<K>(k), std::forward<Args>(args)...).second;
   }
-	template<class K, class V>
+	template<class K, class V, class Alloc>
 	template <class... Args>
-	bool KvMap<K, V>::try_emplace(const K& k, Args&&... args) {
+	bool KvMap<K, V, Alloc>::try_emplace(const K& k, Args&&... args) {
 		return internalMap.try_emplace(k, std::forward<Args>(args)...).second;
 	}
-	template<class K, class V>
-	bool KvMap<K, V>::insert(std::pair<K, V> && pair) {
+	template<class K, class V, class Alloc>
+	bool KvMap<K, V, Alloc>::insert(std::pair<K, V> && pair) {
 		return internalMap.insert(std::forward<std::pair<K, V>>(pair)).second;
 	}
-	template<class K, class V>
-	bool KvMap<K, V>::insert(K&& k, V&& v) {
+	template<class K, class V, class Alloc>
+	bool KvMap<K, V, Alloc>::insert(K&& k, V&& v) {
 		return internalMap.insert(std::make_pair(std::forward<K>(k), std::forward<V>(v))).second;
 	}
-	template<class K, class V>
-	bool KvMap<K, V>::insert(const K& k, V&& v) {
+	template<class K, class V, class Alloc>
+	bool KvMap<K, V, Alloc>::insert(const K& k, V&& v) {
 		return internalMap.insert(std::make_pair(k, std::forward<V>(v))).second;
 	}
-  template<class K, class V>
-  bool KvMap<K, V>::erase(const K &key) {
+	template<class K, class V, class Alloc>
+	size_t KvMap<K, V, Alloc>::insertBulk(const K* keys, V* values, size_t count) {
+#ifdef EZECS_SPARSE_STORAGE
+		return internalMap.insertBulk(keys, values, count);
+#else
+		internalMap.reserve(internalMap.size() + count);
+		size_t inserted = 0;
+		for (size_t i = 0; i < count; ++i) {
+			inserted += internalMap.try_emplace(keys[i], std::move(values[i])).second;
+		}
+		return inserted;
+#endif
+	}
+  template<class K, class V, class Alloc>
+  bool KvMap<K, V, Alloc>::erase(const K &key) {
     return (bool) internalMap.erase(key);
   }
-  template<class K, class V>
-  void KvMap<K, V>::reserve(std::size_t n) {
+  template<class K, class V, class Alloc>
+  void KvMap<K, V, Alloc>::reserve(std::size_t n) {
     internalMap.reserve(n);
   }
-  template<class K, class V>
-  size_t KvMap<K, V>::count(const K &key) const {
+  template<class K, class V, class Alloc>
+  size_t KvMap<K, V, Alloc>::count(const K &key) const {
     return internalMap.count(key);
   }
-  template<class K, class V>
-  typename KvMap<K, V>::const_iterator KvMap<K, V>::begin() const {
+  template<class K, class V, class Alloc>
+  size_t KvMap<K, V, Alloc>::size() const {
+    return internalMap.size();
+  }
+  template<class K, class V, class Alloc>
+  typename KvMap<K, V, Alloc>::iterator KvMap<K, V, Alloc>::begin() {
     return internalMap.begin();
   }
-  template<class K, class V>
-  typename KvMap<K, V>::const_iterator KvMap<K, V>::end() const {
+  template<class K, class V, class Alloc>
+  typename KvMap<K, V, Alloc>::iterator KvMap<K, V, Alloc>::end() {
     return internalMap.end();
   }
+  template<class K, class V, class Alloc>
+  typename KvMap<K, V, Alloc>::const_iterator KvMap<K, V, Alloc>::begin() const {
+    return internalMap.begin();
+  }
+  template<class K, class V, class Alloc>
+  typename KvMap<K, V, Alloc>::const_iterator KvMap<K, V, Alloc>::end() const {
+    return internalMap.end();
+  }
+  template<class K, class V, class Alloc>
+  MemoryUsage KvMap<K, V, Alloc>::memoryUsage() const {
+#ifdef EZECS_SPARSE_STORAGE
+    return internalMap.memoryUsage();
+#else
+    MemoryUsage usage;
+    size_t size = internalMap.size();
+    size_t usedBuckets = std::min(size, internalMap.bucket_count());
+    usage.payload = size * sizeof(V);
+    usage.overhead = size * (sizeof(std::pair<const K, V>) - sizeof(V) + sizeof(void*)) + usedBuckets * sizeof(void*);
+    usage.slack = (internalMap.bucket_count() - usedBuckets) * sizeof(void*);
+    return usage;
+#endif
+  }
+  template<class K, class V, class Alloc>
+  void KvMap<K, V, Alloc>::shrinkToFit() {
+#ifdef EZECS_SPARSE_STORAGE
+    internalMap.shrinkToFit();
+#else
+    internalMap.rehash(0); // as few buckets as the current size allows
+#endif
+  }
+#ifdef EZECS_SPARSE_STORAGE
+  template<class K, class V, class Alloc>
+  const K* KvMap<K, V, Alloc>::keyData() const {
+    return internalMap.keys();
+  }
+  template<class K, class V, class Alloc>
+  V* KvMap<K, V, Alloc>::valueData() {
+    return internalMap.values();
+  }
+#endif
 }
@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2016 Galen Cochrane
+ * Galen Cochrane <galencochrane@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "ecsMappedFile.hpp"
+#ifdef _WIN32
+#  define WIN32_LEAN_AND_MEAN
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+namespace ezecs {
+
+  MappedFile::~MappedFile() {
+    close();
+  }
+
+  bool MappedFile::isOpen() const {
+#ifdef _WIN32
+    return file != nullptr;
+#else
+    return file != -1;
+#endif
+  }
+
+  unsigned char *MappedFile::data() {
+    return mapped;
+  }
+
+  size_t MappedFile::size() const {
+    return mappedSize;
+  }
+
+#ifdef _WIN32
+
+  bool MappedFile::open(const std::string &path) {
+    close();
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS,
+                                FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) {
+      return false;
+    }
+    file = handle;
+    LARGE_INTEGER size;
+    if ( ! GetFileSizeEx(handle, &size)) {
+      close();
+      return false;
+    }
+    mappedSize = (size_t) size.QuadPart;
+    if ( ! map()) {
+      close();
+      return false;
+    }
+    return true;
+  }
+
+  bool MappedFile::resize(size_t size) {
+    if ( ! isOpen()) {
+      return false;
+    }
+    unmap();
+    LARGE_INTEGER distance;
+    distance.QuadPart = (LONGLONG) size;
+    if ( ! SetFilePointerEx((HANDLE) file, distance, nullptr, FILE_BEGIN) || ! SetEndOfFile((HANDLE) file)) {
+      map();
+      return false;
+    }
+    mappedSize = size;
+    return map();
+  }
+
+  void MappedFile::flush() {
+    if (mapped) {
+      FlushViewOfFile(mapped, 0);
+    }
+  }
+
+  void MappedFile::close() {
+    unmap();
+    if (file) {
+      CloseHandle((HANDLE) file);
+      file = nullptr;
+    }
+    mappedSize = 0;
+  }
+
+  bool MappedFile::map() {
+    if ( ! mappedSize) {
+      return true; // an empty file cannot be mapped, and needs no mapping
+    }
+    mapping = CreateFileMappingA((HANDLE) file, nullptr, PAGE_READWRITE, 0, 0, nullptr);
+    if ( ! mapping) {
+      return false;
+    }
+    mapped = (unsigned char *) MapViewOfFile((HANDLE) mapping, FILE_MAP_ALL_ACCESS, 0, 0, mappedSize);
+    return mapped != nullptr;
+  }
+
+  void MappedFile::unmap() {
+    if (mapped) {
+      UnmapViewOfFile(mapped);
+      mapped = nullptr;
+    }
+    if (mapping) {
+      CloseHandle((HANDLE) mapping);
+      mapping = nullptr;
+    }
+  }
+
+#else
+
+  bool MappedFile::open(const std::string &path) {
+    close();
+    file = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (file == -1) {
+      return false;
+    }
+    struct stat info;
+    if (fstat(file, &info) != 0) {
+      close();
+      return false;
+    }
+    mappedSize = (size_t) info.st_size;
+    if ( ! map()) {
+      close();
+      return false;
+    }
+    return true;
+  }
+
+  bool MappedFile::resize(size_t size) {
+    if ( ! isOpen()) {
+      return false;
+    }
+    unmap();
+    if (ftruncate(file, (off_t) size) != 0) {
+      map();
+      return false;
+    }
+    mappedSize = size;
+    return map();
+  }
+
+  void MappedFile::flush() {
+    if (mapped) {
+      msync(mapped, mappedSize, MS_ASYNC);
+    }
+  }
+
+  void MappedFile::close() {
+    unmap();
+    if (file != -1) {
+      ::close(file);
+      file = -1;
+    }
+    mappedSize = 0;
+  }
+
+  bool MappedFile::map() {
+    if ( ! mappedSize) {
+      return true; // an empty file cannot be mapped, and needs no mapping
+    }
+    void *address = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_SHARED, file, 0);
+    if (address == MAP_FAILED) {
+      return false;
+    }
+    mapped = (unsigned char *) address;
+    return true;
+  }
+
+  void MappedFile::unmap() {
+    if (mapped) {
+      munmap(mapped, mappedSize);
+      mapped = nullptr;
+    }
+  }
+
+#endif
+}
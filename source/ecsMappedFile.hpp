@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2016 Galen Cochrane
+ * Galen Cochrane <galencochrane@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * A file mapped into memory, so that its contents can be read and written as a plain array and are paged in and out
+ * by the operating system. State uses this to keep persistent entities across restarts (see
+ * State::mapPersistentStorage).
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+namespace ezecs {
+
+  class MappedFile {
+    public:
+      MappedFile() = default;
+      ~MappedFile();
+      MappedFile(const MappedFile &) = delete;
+      MappedFile &operator = (const MappedFile &) = delete;
+
+      /*
+       * Opens the file at path, creating it if it does not exist, and maps its whole contents
+       */
+      bool open(const std::string &path);
+
+      /*
+       * Changes the size of the file and remaps it. Pointers into the old mapping are invalidated.
+       */
+      bool resize(size_t size);
+
+      /*
+       * Starts writing changed pages out to the file, without waiting for them
+       */
+      void flush();
+      void close();
+
+      bool isOpen() const;
+      unsigned char *data();
+      size_t size() const;
+
+    private:
+#ifdef _WIN32
+      void *file = nullptr;
+      void *mapping = nullptr;
+#else
+      int file = -1;
+#endif
+      unsigned char *mapped = nullptr;
+      size_t mappedSize = 0;
+
+      bool map();
+      void unmap();
+  };
+}
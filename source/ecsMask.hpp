@@ -0,0 +1,224 @@
+/*
+ * Copyright (c) 2016 Galen Cochrane
+ * Galen Cochrane <galencochrane@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+# define EZECS_MASK_SSE2
+# include <emmintrin.h>
+#endif
+
+namespace ezecs {
+
+/*
+ * WideMask is a fixed-width set of bits that takes the place of compMask (see ecsTypes.hpp) when there are more
+ * component types than fit in 32 bits. It acts like an unsigned integer as far as the bitwise operators go, and it
+ * converts from integers by sign extension, so the NONE (0), ALL (-1) and EXISTENCE (1) enumerators keep working.
+ * The operators work on 128 bits at a time with SSE2 where it is available (and on 64 bits at a time otherwise), and
+ * fall back on plain loops when evaluated at compile time, so the generated flag constants can still be constexpr.
+ */
+  template<unsigned numWords>
+  class WideMask {
+      static_assert(numWords % 2 == 0, "A WideMask is made of whole 128-bit lanes");
+    public:
+      constexpr WideMask() : words{} { }
+      constexpr WideMask(long long value) : words{} {
+        for (unsigned w = 0; w < numWords; ++w) {
+          words[w] = w ? (value < 0 ? ~0ull : 0ull) : (uint64_t) value;
+        }
+      }
+      static constexpr WideMask bit(unsigned index) {
+        WideMask mask;
+        mask.words[index / 64] = 1ull << (index % 64);
+        return mask;
+      }
+
+      constexpr WideMask &operator&=(const WideMask &other);
+      constexpr WideMask &operator|=(const WideMask &other);
+      constexpr WideMask &operator^=(const WideMask &other);
+      constexpr WideMask operator~() const;
+      constexpr explicit operator bool() const;
+      constexpr bool includes(const WideMask &required) const;
+      constexpr WideMask lowest() const;
+      constexpr unsigned lowestIndex() const;
+      size_t hash() const;
+
+      friend constexpr WideMask operator&(WideMask a, const WideMask &b) { return a &= b; }
+      friend constexpr WideMask operator|(WideMask a, const WideMask &b) { return a |= b; }
+      friend constexpr WideMask operator^(WideMask a, const WideMask &b) { return a ^= b; }
+      friend constexpr bool operator==(const WideMask &a, const WideMask &b) { return ! (a ^ b); }
+      friend constexpr bool operator!=(const WideMask &a, const WideMask &b) { return (bool) (a ^ b); }
+
+    private:
+      alignas(16) uint64_t words[numWords];
+#ifdef EZECS_MASK_SSE2
+      __m128i lane(unsigned l) const { return _mm_load_si128(reinterpret_cast<const __m128i*>(words) + l); }
+      void setLane(unsigned l, __m128i value) { _mm_store_si128(reinterpret_cast<__m128i*>(words) + l, value); }
+#endif
+  };
+
+/*
+ * These work on either kind of mask. "hasAll" tells whether 'mask' has every bit that is in 'required' (which is what
+ * prerequisite checks, listener likenesses and queries all come down to), "lowestFlag" isolates the lowest set bit,
+ * and "flagIndex" gives the position of the lowest set bit (which must exist).
+ */
+  constexpr bool hasAll(const uint32_t &mask, const uint32_t &required) { return (mask & required) == required; }
+  constexpr uint32_t lowestFlag(const uint32_t &mask) { return mask & (~mask + 1); }
+  constexpr unsigned flagIndex(const uint32_t &mask) { return (unsigned) std::countr_zero(mask); }
+  template<unsigned numWords>
+  constexpr bool hasAll(const WideMask<numWords> &mask, const WideMask<numWords> &required) {
+    return mask.includes(required);
+  }
+  template<unsigned numWords>
+  constexpr WideMask<numWords> lowestFlag(const WideMask<numWords> &mask) { return mask.lowest(); }
+  template<unsigned numWords>
+  constexpr unsigned flagIndex(const WideMask<numWords> &mask) { return mask.lowestIndex(); }
+
+  template<unsigned numWords>
+  constexpr WideMask<numWords> &WideMask<numWords>::operator&=(const WideMask &other) {
+#ifdef EZECS_MASK_SSE2
+    if ( ! std::is_constant_evaluated()) {
+      for (unsigned l = 0; l < numWords / 2; ++l) {
+        setLane(l, _mm_and_si128(lane(l), other.lane(l)));
+      }
+      return *this;
+    }
+#endif
+    for (unsigned w = 0; w < numWords; ++w) {
+      words[w] &= other.words[w];
+    }
+    return *this;
+  }
+  template<unsigned numWords>
+  constexpr WideMask<numWords> &WideMask<numWords>::operator|=(const WideMask &other) {
+#ifdef EZECS_MASK_SSE2
+    if ( ! std::is_constant_evaluated()) {
+      for (unsigned l = 0; l < numWords / 2; ++l) {
+        setLane(l, _mm_or_si128(lane(l), other.lane(l)));
+      }
+      return *this;
+    }
+#endif
+    for (unsigned w = 0; w < numWords; ++w) {
+      words[w] |= other.words[w];
+    }
+    return *this;
+  }
+  template<unsigned numWords>
+  constexpr WideMask<numWords> &WideMask<numWords>::operator^=(const WideMask &other) {
+#ifdef EZECS_MASK_SSE2
+    if ( ! std::is_constant_evaluated()) {
+      for (unsigned l = 0; l < numWords / 2; ++l) {
+        setLane(l, _mm_xor_si128(lane(l), other.lane(l)));
+      }
+      return *this;
+    }
+#endif
+    for (unsigned w = 0; w < numWords; ++w) {
+      words[w] ^= other.words[w];
+    }
+    return *this;
+  }
+  template<unsigned numWords>
+  constexpr WideMask<numWords> WideMask<numWords>::operator~() const {
+    WideMask result;
+    for (unsigned w = 0; w < numWords; ++w) {
+      result.words[w] = ~words[w];
+    }
+    return result;
+  }
+  template<unsigned numWords>
+  constexpr WideMask<numWords>::operator bool() const {
+#ifdef EZECS_MASK_SSE2
+    if ( ! std::is_constant_evaluated()) {
+      __m128i any = lane(0);
+      for (unsigned l = 1; l < numWords / 2; ++l) {
+        any = _mm_or_si128(any, lane(l));
+      }
+      return _mm_movemask_epi8(_mm_cmpeq_epi8(any, _mm_setzero_si128())) != 0xffff;
+    }
+#endif
+    uint64_t any = 0;
+    for (unsigned w = 0; w < numWords; ++w) {
+      any |= words[w];
+    }
+    return any != 0;
+  }
+  template<unsigned numWords>
+  constexpr bool WideMask<numWords>::includes(const WideMask &required) const {
+#ifdef EZECS_MASK_SSE2
+    if ( ! std::is_constant_evaluated()) {
+      __m128i missing = _mm_setzero_si128();
+      for (unsigned l = 0; l < numWords / 2; ++l) {
+        missing = _mm_or_si128(missing, _mm_andnot_si128(lane(l), required.lane(l)));
+      }
+      return _mm_movemask_epi8(_mm_cmpeq_epi8(missing, _mm_setzero_si128())) == 0xffff;
+    }
+#endif
+    uint64_t missing = 0;
+    for (unsigned w = 0; w < numWords; ++w) {
+      missing |= required.words[w] & ~words[w];
+    }
+    return missing == 0;
+  }
+  template<unsigned numWords>
+  constexpr WideMask<numWords> WideMask<numWords>::lowest() const {
+    WideMask result;
+    for (unsigned w = 0; w < numWords; ++w) {
+      if (words[w]) {
+        result.words[w] = words[w] & (~words[w] + 1);
+        break;
+      }
+    }
+    return result;
+  }
+  template<unsigned numWords>
+  constexpr unsigned WideMask<numWords>::lowestIndex() const {
+    for (unsigned w = 0; w < numWords; ++w) {
+      if (words[w]) {
+        return w * 64 + (unsigned) std::countr_zero(words[w]);
+      }
+    }
+    return numWords * 64;
+  }
+  template<unsigned numWords>
+  size_t WideMask<numWords>::hash() const {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (unsigned w = 0; w < numWords; ++w) {
+      hash = (hash ^ words[w]) * 0x100000001b3ull;
+    }
+    return (size_t) (hash ^ (hash >> 32));
+  }
+}
+
+namespace std {
+  template<unsigned numWords>
+  struct hash<ezecs::WideMask<numWords>> {
+    size_t operator()(const ezecs::WideMask<numWords> &mask) const { return mask.hash(); }
+  };
+}
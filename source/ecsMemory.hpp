@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2016 Galen Cochrane
+ * Galen Cochrane <galencochrane@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Memory accounting. Containers that ezecs keeps a lot of (KvMap, SparseSet, ChangeTracker, IdRegistry and the listener
+ * delegates) can report how many bytes they take up as a MemoryUsage, and State::memoryReport gathers them all into a
+ * MemoryReport. Only memory owned by a container is counted. In particular, blocks that pooled component types (see
+ * ecsAllocators.hpp) have returned to their pool are not, since pools are shared by every State.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace ezecs {
+
+  /*
+   * Bytes held by a container: what its elements take (payload), what it spends on finding and keeping track of them
+   * (overhead, such as keys, indices, links and hash buckets), and what it has allocated but is not using (slack).
+   */
+  struct MemoryUsage {
+    size_t payload = 0;
+    size_t overhead = 0;
+    size_t slack = 0;
+
+    size_t total() const { return payload + overhead + slack; }
+    MemoryUsage &operator += (const MemoryUsage &other);
+
+    /*
+     * The usage of a vector whose elements are all payload (or all overhead, with asOverhead)
+     */
+    template<class T, class Alloc>
+    static MemoryUsage of(const std::vector<T, Alloc> &vec, bool asOverhead = false);
+  };
+
+  struct CollectionMemory {
+    const char* name; // of the component type
+    size_t count;
+    MemoryUsage usage;
+    size_t highWater; // the most bytes that the collection has held (see State::memoryReport)
+  };
+
+  struct RegistryMemory {
+    std::string system;
+    size_t registry; // its position among the system's registries
+    size_t count;
+    MemoryUsage usage;
+  };
+
+  struct MemoryReport {
+    std::vector<CollectionMemory> collections; // one per component type, in the order of their flags
+    std::vector<RegistryMemory> registries;    // added by System::reportMemory
+    MemoryUsage callbacks;                     // the delegates of every listener
+    MemoryUsage entities;                      // the entity slots (and with EZECS_ARCHETYPES, the chunks' IDs)
+    size_t highWater = 0;                      // the most bytes that the State has held (registries not included)
+
+    MemoryUsage total() const;
+  };
+
+  inline MemoryUsage &MemoryUsage::operator += (const MemoryUsage &other) {
+    payload += other.payload;
+    overhead += other.overhead;
+    slack += other.slack;
+    return *this;
+  }
+  template<class T, class Alloc>
+  MemoryUsage MemoryUsage::of(const std::vector<T, Alloc> &vec, bool asOverhead) {
+    MemoryUsage usage;
+    (asOverhead ? usage.overhead : usage.payload) = vec.size() * sizeof(T);
+    usage.slack = (vec.capacity() - vec.size()) * sizeof(T);
+    return usage;
+  }
+
+  inline MemoryUsage MemoryReport::total() const {
+    MemoryUsage usage = callbacks;
+    usage += entities;
+    for (auto &collection : collections) {
+      usage += collection.usage;
+    }
+    for (auto &registry : registries) {
+      usage += registry.usage;
+    }
+    return usage;
+  }
+
+}
@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2016 Galen Cochrane
+ * Galen Cochrane <galencochrane@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include "ecsProfiler.hpp"
+
+namespace ezecs {
+
+  Profiler &Profiler::shared() {
+    static Profiler profiler;
+    return profiler;
+  }
+
+  uint64_t Profiler::now() {
+    return (uint64_t) std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  uint32_t Profiler::threadNumber() {
+    // Small numbers read better than hashed thread IDs in a trace viewer
+    static std::atomic<uint32_t> nextNumber { 0 };
+    thread_local uint32_t number = nextNumber++;
+    return number;
+  }
+
+  void Profiler::recordSpan(const char* name, const char* category, uint64_t start, uint64_t duration) {
+    uint32_t thread = threadNumber();
+    std::lock_guard<std::mutex> lock(mutex);
+    events.push_back({ name, category, 'X', thread, start, duration });
+  }
+
+  void Profiler::recordCounter(const std::string &name, uint64_t value) {
+    uint32_t thread = threadNumber();
+    uint64_t timestamp = now();
+    std::lock_guard<std::mutex> lock(mutex);
+    events.push_back({ name, "counter", 'C', thread, timestamp, value });
+  }
+
+  static void writeJsonString(FILE* file, const std::string &str) {
+    fputc('"', file);
+    for (char c : str) {
+      if (c == '"' || c == '\\') {
+        fputc('\\', file);
+        fputc(c, file);
+      } else if ((unsigned char) c < 0x20) {
+        fprintf(file, "\\u%04x", (unsigned) c);
+      } else {
+        fputc(c, file);
+      }
+    }
+    fputc('"', file);
+  }
+
+  bool Profiler::writeChromeTrace(const std::string &path) {
+    FILE* file = fopen(path.c_str(), "w");
+    if ( ! file) {
+      return false;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    fputs("{\"traceEvents\":[\n", file);
+    for (size_t i = 0; i < events.size(); ++i) {
+      const Event &event = events[i];
+      fputs("{\"name\":", file);
+      writeJsonString(file, event.name);
+      fprintf(file, ",\"cat\":\"%s\",\"ph\":\"%c\",\"pid\":0,\"tid\":%" PRIu32 ",\"ts\":%" PRIu64,
+              event.category, event.phase, event.thread, event.timestamp);
+      if (event.phase == 'C') {
+        fprintf(file, ",\"args\":{\"value\":%" PRIu64 "}}", event.duration);
+      } else {
+        fprintf(file, ",\"dur\":%" PRIu64 "}", event.duration);
+      }
+      fputs(i + 1 < events.size() ? ",\n" : "\n", file);
+    }
+    fputs("],\"displayTimeUnit\":\"ms\"}\n", file);
+    return fclose(file) == 0;
+  }
+
+  void Profiler::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    events.clear();
+  }
+
+}
@@ -0,0 +1,154 @@
+/*
+ * Copyright (c) 2016 Galen Cochrane
+ * Galen Cochrane <galencochrane@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Opt-in instrumentation, compiled in with EZECS_PROFILING (see CMakeLists.txt). System ticks and some of State's
+ * bigger operations are timed with scoped timers, and State counts the structural operations and delegate fires of
+ * every component type (see State::getProfile and State::publishProfile). The spans and counts are collected by the
+ * Profiler, which can write them out as a Chrome trace event file to open in chrome://tracing or Perfetto.
+ *
+ * Without EZECS_PROFILING, EZECS_PROFILE_SCOPE expands to nothing and State keeps no counts, so nothing is timed or
+ * counted at all.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace ezecs {
+
+  /*
+   * A count that systems ticked in parallel (see ecsScheduler.hpp) can add to at once. Nothing is ordered by it, so its
+   * operations are relaxed, which costs no more than a plain increment on most platforms.
+   */
+  class ProfileCounter {
+    public:
+      ProfileCounter() = default;
+      ProfileCounter(const ProfileCounter &other) : value(other.value.load(std::memory_order_relaxed)) { }
+      ProfileCounter &operator=(const ProfileCounter &other) {
+        value.store(other.value.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        return *this;
+      }
+      ProfileCounter &operator++() {
+        value.fetch_add(1, std::memory_order_relaxed);
+        return *this;
+      }
+      ProfileCounter &operator+=(uint64_t count) {
+        value.fetch_add(count, std::memory_order_relaxed);
+        return *this;
+      }
+      operator uint64_t() const { return value.load(std::memory_order_relaxed); }
+
+    private:
+      std::atomic<uint64_t> value{ 0 };
+  };
+
+  /*
+   * The counts that a State keeps for one component type. For Existence, additions and removals count the entities
+   * created and deleted.
+   */
+  struct CompProfile {
+    ProfileCounter additions;
+    ProfileCounter removals;
+    ProfileCounter additionFires; // delegates fired because a component of this type was added
+    ProfileCounter removalFires;  // delegates fired because a component of this type was removed
+  };
+
+  class Profiler {
+    public:
+      /*
+       * The profiler that timers and State::publishProfile record into
+       */
+      static Profiler &shared();
+
+      /*
+       * Microseconds on a steady clock, which is what trace events are timed in
+       */
+      static uint64_t now();
+
+      /*
+       * Records a span of time on the calling thread. May be called from any thread.
+       */
+      void recordSpan(const char* name, const char* category, uint64_t start, uint64_t duration);
+
+      /*
+       * Records the value of a counter at the current time. May be called from any thread.
+       */
+      void recordCounter(const std::string &name, uint64_t value);
+
+      /*
+       * Writes everything recorded so far in Chrome's trace event format (JSON)
+       * @return false if the file could not be written
+       */
+      bool writeChromeTrace(const std::string &path);
+
+      /*
+       * Forgets everything recorded so far
+       */
+      void clear();
+
+    private:
+      struct Event {
+        std::string name;
+        const char* category;
+        char phase; // 'X' for a span, 'C' for a counter
+        uint32_t thread;
+        uint64_t timestamp;
+        uint64_t duration; // the value of a counter
+      };
+      std::mutex mutex;
+      std::vector<Event> events;
+
+      static uint32_t threadNumber();
+  };
+
+  /*
+   * Records the time from its construction to its destruction as a span. The name must outlive the timer.
+   */
+  class ScopedTimer {
+    public:
+      ScopedTimer(const char* name, const char* category) : name(name), category(category), start(Profiler::now()) { }
+      ~ScopedTimer() { Profiler::shared().recordSpan(name, category, start, Profiler::now() - start); }
+      ScopedTimer(const ScopedTimer &) = delete;
+      ScopedTimer &operator = (const ScopedTimer &) = delete;
+
+    private:
+      const char* name;
+      const char* category;
+      uint64_t start;
+  };
+
+}
+
+#ifdef EZECS_PROFILING
+#  define EZECS_PROFILE_CONCAT_(a, b) a##b
+#  define EZECS_PROFILE_CONCAT(a, b) EZECS_PROFILE_CONCAT_(a, b)
+#  define EZECS_PROFILE_SCOPE(name, category) \
+     ezecs::ScopedTimer EZECS_PROFILE_CONCAT(ezecsScopedTimer, __LINE__)(name, category)
+#else
+#  define EZECS_PROFILE_SCOPE(name, category)
+#endif
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2016 Galen Cochrane
+ * Galen Cochrane <galencochrane@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include <algorithm>
+#include "ecsRelevancy.hpp"
+#include "ecsState.generated.hpp"
+
+namespace ezecs {
+
+  void Relevancy::setPredicate(std::function<bool(const clientKey &client, const entityId &id)> &&predicate) {
+    this->predicate = std::move(predicate);
+  }
+
+  void Relevancy::setCellOf(std::function<cellKey(const entityId &id)> &&cellOf) {
+    this->cellOf = std::move(cellOf);
+  }
+
+  void Relevancy::setClientCells(const clientKey &client, std::vector<cellKey> &&cells) {
+    views[client].cells = std::move(cells);
+  }
+
+  void Relevancy::update(State &state, const std::vector<clientKey> &clients) {
+    std::vector<entityId> allIds;
+    allIds.reserve(state.getDumpRef().size());
+    for (auto &&pair : state.getDumpRef()) {
+      allIds.push_back(pair.first);
+    }
+    for (auto &cell : entitiesByCell) {
+      cell.second.clear(); // cells are kept, so that their storage is re-used
+    }
+    if (cellOf) {
+      for (auto id : allIds) {
+        entitiesByCell[cellOf(id)].push_back(id);
+      }
+    }
+    std::unordered_map<clientKey, ClientView> connected;
+    for (auto client : clients) {
+      auto found = views.find(client);
+      ClientView &view = connected[client];
+      if (found != views.end()) {
+        view = std::move(found->second);
+      }
+      updateView(view, client, allIds);
+    }
+    views.swap(connected);
+  }
+
+  bool Relevancy::isRelevant(const clientKey &client, const entityId &id) const {
+    auto found = views.find(client);
+    return found != views.end() && found->second.relevant.count(id);
+  }
+
+  const std::unordered_set<entityId> *Relevancy::relevantTo(const clientKey &client) const {
+    auto found = views.find(client);
+    return found == views.end() ? nullptr : &found->second.relevant;
+  }
+
+  const std::vector<entityId> &Relevancy::enteredFor(const clientKey &client) const {
+    auto found = views.find(client);
+    return found == views.end() ? none : found->second.entered;
+  }
+
+  const std::vector<entityId> &Relevancy::leftFor(const clientKey &client) const {
+    auto found = views.find(client);
+    return found == views.end() ? none : found->second.left;
+  }
+
+  void Relevancy::updateView(ClientView &view, const clientKey &client, const std::vector<entityId> &allIds) {
+    std::unordered_set<entityId> relevant;
+    auto consider = [&](const std::vector<entityId> &ids) {
+      for (auto id : ids) {
+        if ( ! predicate || predicate(client, id)) {
+          relevant.insert(id);
+        }
+      }
+    };
+    if (cellOf) {
+      auto global = entitiesByCell.find(everywhere);
+      if (global != entitiesByCell.end()) {
+        consider(global->second);
+      }
+      for (auto cell : view.cells) {
+        auto found = entitiesByCell.find(cell);
+        if (cell != everywhere && found != entitiesByCell.end()) {
+          consider(found->second);
+        }
+      }
+    } else {
+      consider(allIds);
+    }
+    view.entered.clear();
+    view.left.clear();
+    for (auto id : relevant) {
+      if ( ! view.relevant.count(id)) {
+        view.entered.push_back(id);
+      }
+    }
+    for (auto id : view.relevant) {
+      if ( ! relevant.count(id)) {
+        view.left.push_back(id);
+      }
+    }
+    // Prerequisite components are added before their dependents on the client, and lower indices were usually made
+    // first, so keep things in ID order.
+    std::sort(view.entered.begin(), view.entered.end());
+    std::sort(view.left.begin(), view.left.end());
+    view.relevant.swap(relevant);
+  }
+}
@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2016 Galen Cochrane
+ * Galen Cochrane <galencochrane@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Relevancy decides which entities each connected client should know about, so that a server with many clients in a
+ * large world only sends each of them what is nearby or otherwise of interest. Give State a Relevancy (see
+ * State::setRelevancy) and State::replicateDeltas will, for each client:
+ *  - send creation requests for entities that have become relevant to it, with all of their serializable components,
+ *  - send deletion requests for entities that are no longer relevant to it (or no longer exist), and
+ *  - only include relevant entities in its deltas.
+ * Entity creations and deletions are then no longer broadcast to every client as they happen.
+ *
+ * Relevance is decided by a spatial grid, a predicate, or both:
+ *  - setCellOf gives the grid cell of an entity (or 'everywhere' for entities that every client needs), and
+ *    setClientCells gives the cells that a client can see, such as the cells around its player.
+ *  - setPredicate decides relevance of an entity to a client directly. With a grid, it is only asked about entities
+ *    in the client's cells, and without one it is asked about every entity for every client.
+ * With neither, every entity is relevant to every client.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "ecsTypes.hpp"
+
+namespace ezecs {
+
+  class State;
+
+  class Relevancy {
+    public:
+      typedef uint64_t clientKey; // the 'g' field of the client's RakNetGUID
+      typedef uint64_t cellKey;
+      static constexpr cellKey everywhere = ~cellKey(0);
+
+      void setPredicate(std::function<bool(const clientKey &client, const entityId &id)> &&predicate);
+      void setCellOf(std::function<cellKey(const entityId &id)> &&cellOf);
+      void setClientCells(const clientKey &client, std::vector<cellKey> &&cells);
+
+      /*
+       * Works out which entities are relevant to each of the given clients, and what has changed since the last
+       * update. Clients not in the list are forgotten.
+       */
+      void update(State &state, const std::vector<clientKey> &clients);
+
+      bool isRelevant(const clientKey &client, const entityId &id) const;
+      const std::unordered_set<entityId> *relevantTo(const clientKey &client) const;
+      const std::vector<entityId> &enteredFor(const clientKey &client) const;
+      const std::vector<entityId> &leftFor(const clientKey &client) const;
+
+    private:
+      struct ClientView {
+        std::vector<cellKey> cells;
+        std::unordered_set<entityId> relevant;
+        std::vector<entityId> entered;
+        std::vector<entityId> left;
+      };
+      std::function<bool(const clientKey &client, const entityId &id)> predicate;
+      std::function<cellKey(const entityId &id)> cellOf;
+      std::unordered_map<clientKey, ClientView> views;
+      std::unordered_map<cellKey, std::vector<entityId>> entitiesByCell;
+      const std::vector<entityId> none;
+
+      void updateView(ClientView &view, const clientKey &client, const std::vector<entityId> &allIds);
+  };
+}
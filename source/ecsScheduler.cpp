@@ -0,0 +1,68 @@
+/*
+ * Copyright (c) 2016 Galen Cochrane
+ * Galen Cochrane <galencochrane@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "ecsScheduler.hpp"
+
+namespace ezecs {
+
+  Scheduler::Scheduler(ThreadPool &pool) : pool(pool) { }
+
+  void Scheduler::add(const SystemAccess &access, std::function<void(double)> &&tick) {
+    size_t added = nodes.size();
+    nodes.push_back(Node{ std::move(tick), access, {}, 0 });
+    // Any earlier system that conflicts with this one must finish before this one starts.
+    for (size_t i = 0; i < added; ++i) {
+      if (conflict(nodes[i].access, access)) {
+        nodes[i].dependents.push_back(added);
+        ++nodes[added].numDependencies;
+      }
+    }
+    numWaiting.reset(new std::atomic<size_t>[nodes.size()]);
+  }
+
+  void Scheduler::tick(double dt) {
+    EZECS_PROFILE_SCOPE("Scheduler::tick", "scheduler");
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      numWaiting[i] = nodes[i].numDependencies;
+    }
+    TaskGroup group(pool);
+    for (size_t i = 0; i < nodes.size(); ++i) {
+      if ( ! nodes[i].numDependencies) {
+        group.run([this, i, dt, &group] { launch(i, dt, group); });
+      }
+    }
+    group.wait();
+  }
+
+  bool Scheduler::conflict(const SystemAccess &a, const SystemAccess &b) {
+    return (a.writes & (b.reads | b.writes)) || (b.writes & a.reads);
+  }
+
+  void Scheduler::launch(size_t node, double dt, TaskGroup &group) {
+    nodes[node].tick(dt);
+    for (auto dependent : nodes[node].dependents) {
+      if ( ! --numWaiting[dependent]) {
+        group.run([this, dependent, dt, &group] { launch(dependent, dt, group); });
+      }
+    }
+  }
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2016 Galen Cochrane
+ * Galen Cochrane <galencochrane@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * The Scheduler ticks a set of systems once per frame, running systems at the same time whenever their declared
+ * component accesses (see SystemAccess in ecsSystem.hpp) allow it. Two systems conflict if either one writes a
+ * component type that the other reads or writes. Conflicting systems always tick in the order they were added, and
+ * systems that don't conflict tick concurrently on a ThreadPool.
+ *
+ * Only component data is protected this way. Systems ticked by the Scheduler must not create or delete entities or
+ * add or remove components directly, since that changes State's collections and fires delegates. Queue such changes
+ * in an EntityCommandBuffer instead (see ecsCommandBuffer.hpp) and flush it after tick returns.
+ *
+ * EXAMPLE: Scheduler scheduler; scheduler.add(physicsSystem); scheduler.add(renderSystem); scheduler.tick(dt);
+ */
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "ecsSystem.hpp"
+#include "ecsThreadPool.hpp"
+
+namespace ezecs {
+
+  class Scheduler {
+    public:
+      explicit Scheduler(ThreadPool &pool = ThreadPool::shared());
+
+      template<typename Derived_System>
+      void add(System<Derived_System> &system);
+      void add(const SystemAccess &access, std::function<void(double)> &&tick);
+
+      /*
+       * Ticks every system once, returning when all of them are done
+       */
+      void tick(double dt);
+
+    private:
+      struct Node {
+        std::function<void(double)> tick;
+        SystemAccess access;
+        std::vector<size_t> dependents;
+        size_t numDependencies = 0;
+      };
+      ThreadPool &pool;
+      std::vector<Node> nodes;
+      std::unique_ptr<std::atomic<size_t>[]> numWaiting;
+
+      static bool conflict(const SystemAccess &a, const SystemAccess &b);
+      void launch(size_t node, double dt, TaskGroup &group);
+  };
+
+  template<typename Derived_System>
+  void Scheduler::add(System<Derived_System> &system) {
+    add(system.getAccess(), [&system](double dt) {
+      if ( ! system.isPaused()) {
+        system.tick(dt);
+      }
+    });
+  }
+}
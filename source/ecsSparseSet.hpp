@@ -0,0 +1,331 @@
+/*
+ * Copyright (c) 2016 Galen Cochrane
+ * Galen Cochrane <galencochrane@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * A sparse set is a map from small integer keys (entity IDs) to values that keeps every value packed together in one
+ * contiguous array. A paged 'sparse' array maps each key's index to a position in the packed 'dense' arrays, so lookups
+ * are plain array indexing and iteration walks contiguous memory. Only the index part of an entity ID selects a slot
+ * (see ecsTypes.hpp) and the whole key is then compared, so a stale ID with an old generation is simply not found.
+ * Removal moves the last element into the hole left by the removed one (swap-and-pop), so the dense arrays never have
+ * gaps, but the order of elements is not stable.
+ *
+ * This provides the subset of the std::unordered_map interface that KvMap uses, so that it can be swapped in as the
+ * internal map of KvMap (see ecsKvMap.hpp). Unlike std::unordered_map, pointers and references to values are
+ * invalidated by any insertion or removal.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "ecsTypes.hpp"
+#include "ecsMemory.hpp"
+
+namespace ezecs {
+
+  template<class K, class VRef>
+  class SparseSetIterator {
+    public:
+      typedef std::pair<const K&, VRef> reference;
+      struct pointer {
+        reference ref;
+        reference* operator -> () { return &ref; }
+      };
+
+      SparseSetIterator(const K* key, typename std::remove_reference<VRef>::type* value) : key(key), value(value) { }
+      reference operator * () const { return reference(*key, *value); }
+      pointer operator -> () const { return pointer{ **this }; }
+      SparseSetIterator& operator ++ () { ++key; ++value; return *this; }
+      bool operator == (const SparseSetIterator& other) const { return key == other.key; }
+      bool operator != (const SparseSetIterator& other) const { return key != other.key; }
+
+    private:
+      const K* key;
+      typename std::remove_reference<VRef>::type* value;
+  };
+
+  template<class K, class V, class Alloc = std::allocator<V>>
+  class SparseSet {
+    private:
+      static constexpr uint32_t pageBits = 12;
+      static constexpr uint32_t pageSize = 1u << pageBits;
+      static constexpr uint32_t npos = ~0u;
+
+      // Everything is allocated through Alloc, so that a pooled component type (see ecsAllocators.hpp) pools its pages
+      // and key arrays as well as its values
+      template<class T>
+      using Rebound = typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
+      typedef std::vector<uint32_t, Rebound<uint32_t>> Page;
+
+      std::vector<Page> sparse;
+      std::vector<K, Rebound<K>> denseKeys;
+      std::vector<V, Alloc> denseValues;
+
+      static size_t indexOf(const K &key);
+      uint32_t& slot(const K &key);
+      uint32_t position(const K &key) const;
+
+    public:
+      typedef SparseSetIterator<K, V&> iterator;
+      typedef SparseSetIterator<K, const V&> const_iterator;
+
+      V &at(const K &key);
+      const V &at(const K &key) const;
+      V& operator [] (const K& key);
+      void clear() noexcept;
+      size_t count(const K &key) const;
+      size_t size() const;
+      iterator find(const K &key);
+
+      template <class... Args>
+      std::pair<iterator, bool> try_emplace(const K& k, Args&&... args);
+      template <class... Args>
+      std::pair<iterator, bool> emplace(const K& k, Args&&... args);
+      std::pair<iterator, bool> insert(std::pair<K, V>&& pair);
+
+      /*
+       * Moves count values in at once, skipping any whose key is already present or appeared earlier in the batch.
+       * When there are none of those, the keys and values are appended to the dense arrays as whole ranges.
+       * Returns the number of values inserted.
+       */
+      size_t insertBulk(const K* keys, V* values, size_t count);
+
+      size_t erase(const K &key);
+      void reserve(std::size_t n);
+
+      const K* keys() const;
+      V* values();
+
+      /*
+       * The values are the payload, and the keys and the pages of the sparse array are overhead
+       */
+      MemoryUsage memoryUsage() const;
+
+      /*
+       * Gives back the unused capacity of the dense arrays, and frees the pages of the sparse array that no longer
+       * index anything
+       */
+      void shrinkToFit();
+
+      iterator begin();
+      iterator end();
+      const_iterator begin() const;
+      const_iterator end() const;
+  };
+
+  template<class K, class V, class Alloc>
+  size_t SparseSet<K, V, Alloc>::indexOf(const K &key) {
+    return static_cast<size_t>(entityIndex(key));
+  }
+  template<class K, class V, class Alloc>
+  uint32_t& SparseSet<K, V, Alloc>::slot(const K &key) {
+    size_t index = indexOf(key);
+    size_t page = index >> pageBits;
+    if (page >= sparse.size()) {
+      sparse.resize(page + 1);
+    }
+    if (sparse[page].empty()) {
+      sparse[page].assign(pageSize, npos);
+    }
+    return sparse[page][index & (pageSize - 1)];
+  }
+  template<class K, class V, class Alloc>
+  uint32_t SparseSet<K, V, Alloc>::position(const K &key) const {
+    size_t index = indexOf(key);
+    size_t page = index >> pageBits;
+    if (page < sparse.size() && ! sparse[page].empty()) {
+      uint32_t pos = sparse[page][index & (pageSize - 1)];
+      if (pos != npos && denseKeys[pos] == key) {
+        return pos;
+      }
+    }
+    return npos;
+  }
+  template<class K, class V, class Alloc>
+  V &SparseSet<K, V, Alloc>::at(const K &key) {
+    uint32_t pos = position(key);
+    if (pos == npos) {
+      throw std::out_of_range("SparseSet::at");
+    }
+    return denseValues[pos];
+  }
+  template<class K, class V, class Alloc>
+  const V &SparseSet<K, V, Alloc>::at(const K &key) const {
+    uint32_t pos = position(key);
+    if (pos == npos) {
+      throw std::out_of_range("SparseSet::at");
+    }
+    return denseValues[pos];
+  }
+  template<class K, class V, class Alloc>
+  V& SparseSet<K, V, Alloc>::operator [] (const K& key) {
+    return (*try_emplace(key).first).second;
+  }
+  template<class K, class V, class Alloc>
+  void SparseSet<K, V, Alloc>::clear() noexcept {
+    for (auto key : denseKeys) {
+      sparse[indexOf(key) >> pageBits][indexOf(key) & (pageSize - 1)] = npos;
+    }
+    denseKeys.clear();
+    denseValues.clear();
+  }
+  template<class K, class V, class Alloc>
+  size_t SparseSet<K, V, Alloc>::count(const K &key) const {
+    return position(key) != npos;
+  }
+  template<class K, class V, class Alloc>
+  size_t SparseSet<K, V, Alloc>::size() const {
+    return denseKeys.size();
+  }
+  template<class K, class V, class Alloc>
+  typename SparseSet<K, V, Alloc>::iterator SparseSet<K, V, Alloc>::find(const K &key) {
+    uint32_t pos = position(key);
+    if (pos == npos) {
+      return end();
+    }
+    return iterator(denseKeys.data() + pos, denseValues.data() + pos);
+  }
+  template<class K, class V, class Alloc>
+  template <class... Args>
+  std::pair<typename SparseSet<K, V, Alloc>::iterator, bool> SparseSet<K, V, Alloc>::try_emplace(const K& k, Args&&... args) {
+    uint32_t pos = position(k);
+    if (pos != npos) {
+      return std::make_pair(iterator(denseKeys.data() + pos, denseValues.data() + pos), false);
+    }
+    pos = static_cast<uint32_t>(denseKeys.size());
+    denseValues.emplace_back(std::forward<Args>(args)...);
+    denseKeys.push_back(k);
+    slot(k) = pos;
+    return std::make_pair(iterator(denseKeys.data() + pos, denseValues.data() + pos), true);
+  }
+  template<class K, class V, class Alloc>
+  template <class... Args>
+  std::pair<typename SparseSet<K, V, Alloc>::iterator, bool> SparseSet<K, V, Alloc>::emplace(const K& k, Args&&... args) {
+    return try_emplace(k, std::forward<Args>(args)...);
+  }
+  template<class K, class V, class Alloc>
+  std::pair<typename SparseSet<K, V, Alloc>::iterator, bool> SparseSet<K, V, Alloc>::insert(std::pair<K, V>&& pair) {
+    return try_emplace(pair.first, std::move(pair.second));
+  }
+  template<class K, class V, class Alloc>
+  size_t SparseSet<K, V, Alloc>::insertBulk(const K* keys, V* values, size_t count) {
+    // Slots are claimed up front, so that a key already present or repeated within the batch is seen before anything
+    // is moved into the dense arrays.
+    uint32_t pos = static_cast<uint32_t>(denseKeys.size());
+    for (size_t i = 0; i < count; ++i) {
+      uint32_t &claimed = slot(keys[i]);
+      if (claimed != npos) { // give back the slots claimed so far and take the slow path
+        for (size_t j = 0; j < i; ++j) {
+          slot(keys[j]) = npos;
+        }
+        size_t inserted = 0;
+        for (size_t j = 0; j < count; ++j) {
+          inserted += try_emplace(keys[j], std::move(values[j])).second;
+        }
+        return inserted;
+      }
+      claimed = pos + static_cast<uint32_t>(i);
+    }
+    denseKeys.insert(denseKeys.end(), keys, keys + count);
+    denseValues.insert(denseValues.end(), std::make_move_iterator(values), std::make_move_iterator(values + count));
+    return count;
+  }
+  template<class K, class V, class Alloc>
+  size_t SparseSet<K, V, Alloc>::erase(const K &key) {
+    uint32_t pos = position(key);
+    if (pos == npos) {
+      return 0;
+    }
+    uint32_t last = static_cast<uint32_t>(denseKeys.size() - 1);
+    if (pos != last) {
+      denseValues[pos] = std::move(denseValues[last]);
+      denseKeys[pos] = denseKeys[last];
+      slot(denseKeys[pos]) = pos;
+    }
+    denseValues.pop_back();
+    denseKeys.pop_back();
+    slot(key) = npos;
+    return 1;
+  }
+  template<class K, class V, class Alloc>
+  void SparseSet<K, V, Alloc>::reserve(std::size_t n) {
+    denseKeys.reserve(n);
+    denseValues.reserve(n);
+  }
+  template<class K, class V, class Alloc>
+  const K* SparseSet<K, V, Alloc>::keys() const {
+    return denseKeys.data();
+  }
+  template<class K, class V, class Alloc>
+  V* SparseSet<K, V, Alloc>::values() {
+    return denseValues.data();
+  }
+  template<class K, class V, class Alloc>
+  MemoryUsage SparseSet<K, V, Alloc>::memoryUsage() const {
+    MemoryUsage usage = MemoryUsage::of(denseValues);
+    usage += MemoryUsage::of(denseKeys, true);
+    usage += MemoryUsage::of(sparse, true);
+    for (auto &page : sparse) {
+      usage.overhead += page.size() * sizeof(uint32_t);
+    }
+    return usage;
+  }
+  template<class K, class V, class Alloc>
+  void SparseSet<K, V, Alloc>::shrinkToFit() {
+    denseKeys.shrink_to_fit();
+    denseValues.shrink_to_fit();
+    std::vector<bool> pageUsed(sparse.size(), false);
+    for (auto key : denseKeys) {
+      pageUsed[indexOf(key) >> pageBits] = true;
+    }
+    for (size_t page = 0; page < sparse.size(); ++page) {
+      if ( ! pageUsed[page]) {
+        Page().swap(sparse[page]); // slot() refills it if it is needed again
+      }
+    }
+    while ( ! sparse.empty() && sparse.back().empty()) {
+      sparse.pop_back();
+    }
+    sparse.shrink_to_fit();
+  }
+  template<class K, class V, class Alloc>
+  typename SparseSet<K, V, Alloc>::iterator SparseSet<K, V, Alloc>::begin() {
+    return iterator(denseKeys.data(), denseValues.data());
+  }
+  template<class K, class V, class Alloc>
+  typename SparseSet<K, V, Alloc>::iterator SparseSet<K, V, Alloc>::end() {
+    return iterator(denseKeys.data() + denseKeys.size(), denseValues.data() + denseValues.size());
+  }
+  template<class K, class V, class Alloc>
+  typename SparseSet<K, V, Alloc>::const_iterator SparseSet<K, V, Alloc>::begin() const {
+    return const_iterator(denseKeys.data(), denseValues.data());
+  }
+  template<class K, class V, class Alloc>
+  typename SparseSet<K, V, Alloc>::const_iterator SparseSet<K, V, Alloc>::end() const {
+    return const_iterator(denseKeys.data() + denseKeys.size(), denseValues.data() + denseValues.size());
+  }
+}
@@ -20,8 +20,10 @@
  * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
  * IN THE SOFTWARE.
  */
-#include <limits>
-#include "ecsState.generated.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include "ecsStateTemplates.hpp"
 #include "ecsHelpers.hpp"
 
 #pragma clang diagnostic ignored "-Wundefined-var-template"
@@ -31,6 +33,31 @@ using namespace SLNet;
 
 namespace ezecs {
 
+	constexpr uint32_t snapshotMagic = 0x4e535a45; // "EZSN"
+	constexpr uint32_t snapshotVersion = 1;
+	constexpr size_t snapshotAlignment = 16; // every block of a snapshot starts at a multiple of this from its start
+
+	/*
+	 * The keys and values of a collection that keeps each of them packed in one array, or null pointers if it does not
+	 */
+#ifdef EZECS_SPARSE_STORAGE
+	template<typename compType>
+	std::pair<const entityId*, compType*> packedData(KvMap<entityId, compType> &coll) {
+		return { coll.keyData(), coll.valueData() };
+	}
+#else
+	template<typename compType>
+	std::pair<const entityId*, compType*> packedData(KvMap<entityId, compType> &) {
+		return { nullptr, nullptr };
+	}
+#endif
+#ifdef EZECS_ARCHETYPES
+	template<typename compType>
+	std::pair<const entityId*, compType*> packedData(ArchetypeColumn<compType> &) {
+		return { nullptr, nullptr }; // spread over the chunks of many archetypes
+	}
+#endif
+
 
 	void State::openEntityRequest() {
 		if (entityRequestOpen) {
@@ -68,7 +95,9 @@ namespace ezecs {
 				} break;
 				default: break;
 			}
-			net.send(stream, LOW_PRIORITY, RELIABLE_ORDERED, network::CH_ECS_UPDATE);
+			if ( ! relevancy || net.getRole() != network::SERVER) { // else replicateDeltas sends it where it is relevant
+				net.send(stream, LOW_PRIORITY, RELIABLE_ORDERED, network::CH_ECS_UPDATE);
+			}
 		} else {
 			publish("err", "Close entity request: No entity request was open!");
 		}
@@ -78,7 +107,7 @@ namespace ezecs {
 
 	void State::broadcastManualEntity(const entityId &id) {
 		// Solo's don't need to do this, and clients should not do this. This might be a redundant check, though.
-		if (net.getRole() == network::SERVER) {
+		if (net.getRole() == network::SERVER && ! relevancy) { // with relevancy, replicateDeltas does this
 			stream.Reset();
 			writeEntityRequestHeader(stream);
 			serializeEntityCreationRequest(true, stream, id);
@@ -89,9 +118,11 @@ namespace ezecs {
 	void State::requestEntityDeletion(const entityId &id) {
 		switch (net.getRole()) {
 			case network::SERVER: {
-				stream.Reset();
-				serializeEntityDeletionRequest(true, stream, id);
-				net.send(stream, LOW_PRIORITY, RELIABLE_ORDERED, network::CH_ECS_UPDATE);
+				if ( ! relevancy) { // with relevancy, replicateDeltas tells the clients that had the entity
+					stream.Reset();
+					serializeEntityDeletionRequest(true, stream, id);
+					net.send(stream, LOW_PRIORITY, RELIABLE_ORDERED, network::CH_ECS_UPDATE);
+				}
 
 				EZECS_VERBOSE(deleteEntity(id));
 			} break;
@@ -121,16 +152,13 @@ namespace ezecs {
 		if (!rw) {  // reading a request
 			if (id) { // Receive a remote server request to change the local client ECS, which gets fulfilled.
 
-				publishf("log", "received entity creation request for %u\n", id);
+				publishf("log", "received entity creation request for %llu\n", (unsigned long long) id);
 
-				// If outgoing ECS request server messages are ordered, we shouldn't need to check for inappropriate id.
-				// That means this loop should always do exactly one iteration, but if it doesn't, we need to fix it.
-				int i = 0;
-				for (; !getComponents(id) && i < 10; ++i) {  // times out after 10 loops if there IS an anomaly
-					createEntity();
-				}
-				if (i != 1) { // TODO: make this an assert?
-					publishf("err", "Anomaly found while processing entity creation request! Check logic (i was %i)!", i);
+				// The server may only send some of its entities (see Relevancy), so the ID is taken exactly as given.
+				CompOpReturn created = createEntityAt(id);
+				if (created != SUCCESS) { // TODO: make this an assert?
+					publishf("err", "Anomaly found while processing entity creation request! Check logic (status was %i)!",
+					         (int) created);
 				}
 				serializeComponentCreationRequest(false, stream, id);
 			} else { // Receive a client's request to update all networked ECS's. The server fulfills it and rebroadcasts.
@@ -141,7 +169,7 @@ namespace ezecs {
 			}
 		} else {  // writing a request
 			if (id) {
-				if (getComponents(id)) {
+				if (isAlive(id)) {
 					serializeComponentCreationRequest(true, stream, id);
 				} else {  // TODO: make this an assert?
 					stream.Reset();
@@ -183,30 +211,364 @@ namespace ezecs {
 		stream.SerializeCompressed(rw, hasComp);
 		return hasComp;
 	}
+
+	void State::replicateDeltas() {
+		if (net.getRole() != network::SERVER) {
+			return;
+		}
+		EZECS_PROFILE_SCOPE("State::replicateDeltas", "state");
+		changeTick sent = advanceChangeTick();
+		std::unordered_map<uint64_t, changeTick> stillConnected;
+		std::unordered_map<changeTick, std::unique_ptr<BitStream>> deltas; // clients that are equally behind share one
+		const DataStructures::List<RakNetGUID> &guids = net.getClientGuids();
+		if (relevancy) {
+			std::vector<Relevancy::clientKey> clients;
+			for (unsigned int i = 0; i < guids.Size(); ++i) {
+				clients.push_back(guids[i].g);
+			}
+			relevancy->update(*this, clients);
+		}
+		for (unsigned int i = 0; i < guids.Size(); ++i) {
+			auto acked = ackedTicks.find(guids[i].g);
+			changeTick since = acked == ackedTicks.end() ? 0 : acked->second;
+			stillConnected.emplace(guids[i].g, since);
+			if (relevancy) { // every client sees something different, so nothing is shared
+				replicateRelevantTo(guids[i], since, sent);
+				continue;
+			}
+			std::unique_ptr<BitStream> &delta = deltas[since];
+			if ( ! delta) {
+				delta = std::make_unique<BitStream>();
+				delta->Write((MessageID)network::ID_SYNC_ECS_DELTA);
+				delta->Write(sent);
+				serializeDelta(true, *delta, since);
+			}
+			net.sendTo(*delta, guids[i], HIGH_PRIORITY, UNRELIABLE_SEQUENCED, network::CH_SIMULATION_UPDATE);
+		}
+		ackedTicks.swap(stillConnected); // forgets clients that have disconnected
+	}
+
+	void State::setRelevancy(Relevancy *relevancy) {
+		this->relevancy = relevancy;
+	}
+
+	void State::replicateRelevantTo(const RakNetGUID &guid, const changeTick &since, const changeTick &sent) {
+		BitStream out; // not the shared stream, which may hold an open entity request
+		for (auto id : relevancy->leftFor(guid.g)) {
+			out.Reset();
+			serializeEntityDeletionRequest(true, out, id);
+			net.sendTo(out, guid, LOW_PRIORITY, RELIABLE_ORDERED, network::CH_ECS_UPDATE);
+		}
+		for (auto id : relevancy->enteredFor(guid.g)) {
+			out.Reset();
+			writeEntityRequestHeader(out);
+			serializeEntityCreationRequest(true, out, id);
+			net.sendTo(out, guid, LOW_PRIORITY, RELIABLE_ORDERED, network::CH_ECS_UPDATE);
+		}
+		out.Reset();
+		out.Write((MessageID)network::ID_SYNC_ECS_DELTA);
+		out.Write(sent);
+		serializeDelta(true, out, since, relevancy->relevantTo(guid.g));
+		net.sendTo(out, guid, HIGH_PRIORITY, UNRELIABLE_SEQUENCED, network::CH_SIMULATION_UPDATE);
+	}
+
+	bool State::needsReplication(const ChangeTracker &changes, const entityId &id, const changeTick &since,
+	                             const std::unordered_set<entityId> *relevant) {
+		return changes.changedSince(id, since) && ( ! relevant || relevant->count(id));
+	}
+
+	bool State::handleDeltaPacket(Packet *packet) {
+		BitStream in(packet->data, packet->length, false);
+		in.IgnoreBytes(sizeof(MessageID));
+		changeTick tick = 0;
+		switch ((MessageID)packet->data[0]) {
+			case network::ID_SYNC_ECS_DELTA: {
+				in.Read(tick);
+				if ( ! serializeDelta(false, in, 0)) {
+					// Some entity's creation, which travels on the reliable CH_ECS_UPDATE channel, has not arrived yet.
+					// Without an acknowledgement, the server keeps sending what changed since the last one.
+					return true;
+				}
+				BitStream ack;
+				ack.Write((MessageID)network::ID_SYNC_ECS_DELTA_ACK);
+				ack.Write(tick);
+				net.send(ack, HIGH_PRIORITY, UNRELIABLE, network::CH_SIMULATION_UPDATE);
+			} return true;
+			case network::ID_SYNC_ECS_DELTA_ACK: {
+				in.Read(tick);
+				changeTick &acked = ackedTicks[packet->guid.g];
+				acked = std::max(acked, tick); // acknowledgements can arrive out of order
+			} return true;
+			default: return false;
+		}
+	}
+
+	bool State::serializeDelta(bool rw, BitStream &stream, const changeTick &since,
+	                           const std::unordered_set<entityId> *relevant) {
+		bool complete = true;
+		// REPLICATE EACH CHANGED COMPONENT TYPE APPEARS HERE
+		return complete;
+	}
+
+	void State::writeSnapshot(BitStream &stream) {
+		writeSnapshotOf(stream, false);
+	}
+
+	void State::writeSnapshotOf(BitStream &stream, bool persistentEntities) {
+		stream.AlignWriteToByteBoundary();
+		size_t start = stream.GetNumberOfBytesUsed();
+		stream.Write(snapshotMagic);
+		stream.Write(snapshotVersion);
+		stream.Write(snapshotSchema);
+		std::vector<bool> skipped; // by entity index, left empty if no entities are to be left out
+		for (auto &&pair : comps_Existence) {
+			if ( ! persistenceMask && ! persistentEntities) {
+				break; // nothing is persistent, so nothing is left out
+			}
+			if ((bool) (pair.second.componentsPresent & persistenceMask) != persistentEntities) {
+				skipped.resize(entitySlots.size());
+				skipped[entityIndex(pair.first)] = true;
+			}
+		}
+		const std::vector<bool> *excluded = skipped.empty() ? nullptr : &skipped;
+		uint64_t numSlots = entitySlots.size();
+		stream.Write(numSlots);
+		padSnapshot(true, stream, start);
+		stream.Write((const char*) entitySlots.data(), (unsigned int) (numSlots * sizeof(entityId)));
+		snapshotComps<Existence, true>(true, stream, start, 0, excluded);
+		serializeSnapshotComps(true, stream, start, excluded);
+	}
+
+	bool State::readSnapshot(BitStream &stream) {
+		stream.AlignReadToByteBoundary();
+		size_t start = stream.GetReadOffset() / 8;
+		uint32_t magic = 0, version = 0;
+		uint64_t schema = 0, check = 0, count = 0;
+		if ( ! stream.Read(magic) || ! stream.Read(version) || ! stream.Read(schema) ||
+		     magic != snapshotMagic || version != snapshotVersion || schema != snapshotSchema) {
+			publish("err", "Snapshot was written by a different version of ezecs or a different component configuration!");
+			return false;
+		}
+		// The entities are read by hand, since nothing may be changed until they are known not to collide.
+		uint64_t numSlots = 0;
+		bool ok = stream.Read(numSlots) && numSlots <= entityIndexMask + 1;
+		std::vector<entityId> slots(ok ? numSlots : 0);
+		padSnapshot(false, stream, start);
+		ok = ok && stream.Read((char*) slots.data(), (unsigned int) (slots.size() * sizeof(entityId)));
+		ok = ok && stream.Read(check) && stream.Read(count) && check == sizeof(Existence);
+		// A corrupt count must not be trusted with an allocation, so it is held to what the stream could possibly hold.
+		ok = ok && count <= entityIndexMask &&
+		     count * (sizeof(entityId) + sizeof(Existence)) <= stream.GetNumberOfUnreadBits() / 8;
+		std::vector<entityId> ids(ok ? count : 0);
+		std::vector<Existence> existences(ids.size());
+		padSnapshot(false, stream, start);
+		ok = ok && stream.Read((char*) ids.data(), (unsigned int) (ids.size() * sizeof(entityId)));
+		padSnapshot(false, stream, start);
+		ok = ok && stream.Read((char*) existences.data(), (unsigned int) (existences.size() * sizeof(Existence)));
+		if ( ! ok) {
+			publish("err", "Snapshot is truncated or corrupt!");
+			return false;
+		}
+		std::vector<bool> seen(std::max<size_t>(slots.size(), entitySlots.size()));
+		for (auto id : ids) {
+			size_t index = entityIndex(id);
+			if ( ! index || index > entityIndexMask ||
+			     (index < entitySlots.size() && entityIndex(entitySlots[index]) == index)) {
+				publishf("err", "Snapshot entity %llu collides with an existing entity!", (unsigned long long) id);
+				return false;
+			}
+			if (index >= seen.size()) {
+				seen.resize(index + 1);
+			}
+			if (seen[index]) {
+				publishf("err", "Snapshot entity %llu appears more than once!", (unsigned long long) id);
+				return false;
+			}
+			seen[index] = true;
+		}
+		for (auto &existence : existences) {
+			existence.componentsPresent &= serializableMask; // only serializable components are in a snapshot
+		}
+		restoreEntitySlots(ids, slots);
+		comps_Existence.insertBulk(ids.data(), existences.data(), ids.size());
+#ifdef EZECS_ARCHETYPES
+		for (auto id : ids) {
+			archetypes.insert(id); // each component moves it on to its archetype as it is read
+		}
+#endif
+		ok = serializeSnapshotComps(false, stream, start, nullptr);
+		fireSnapshotCallbacks(ids, existences);
+		return ok;
+	}
+
+	bool State::saveSnapshot(const std::string &path) {
+		BitStream snapshot;
+		writeSnapshot(snapshot);
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file.write((const char*) snapshot.GetData(), snapshot.GetNumberOfBytesUsed());
+		return file.good();
+	}
+
+	bool State::loadSnapshot(const std::string &path) {
+		std::ifstream file(path, std::ios::binary | std::ios::ate);
+		if ( ! file) {
+			return false;
+		}
+		std::vector<unsigned char> data((size_t) file.tellg());
+		file.seekg(0);
+		if ( ! file.read((char*) data.data(), data.size())) {
+			return false;
+		}
+		BitStream snapshot(data.data(), (unsigned int) data.size(), false);
+		return readSnapshot(snapshot);
+	}
+
+	bool State::mapPersistentStorage(const std::string &path) {
+		if ( ! persistentStorage.open(path)) {
+			publishf("err", "Could not map persistent storage at %s!", path.c_str());
+			return false;
+		}
+		if ( ! persistentStorage.size()) {
+			return true; // nothing has been kept there yet
+		}
+		BitStream mapped(persistentStorage.data(), (unsigned int) persistentStorage.size(), false);
+		return readSnapshot(mapped);
+	}
+
+	void State::syncPersistentStorage() {
+		if ( ! persistentStorage.isOpen()) {
+			return;
+		}
+		BitStream snapshot;
+		writeSnapshotOf(snapshot, true);
+		size_t size = snapshot.GetNumberOfBytesUsed();
+		if (size != persistentStorage.size() && ! persistentStorage.resize(size)) {
+			publish("err", "Could not resize persistent storage!");
+			return;
+		}
+		memcpy(persistentStorage.data(), snapshot.GetData(), size);
+		persistentStorage.flush();
+	}
+
+	void State::padSnapshot(bool rw, BitStream &stream, size_t start) {
+		size_t offset = (rw ? stream.GetNumberOfBytesUsed() : stream.GetReadOffset() / 8) - start;
+		size_t padding = (snapshotAlignment - offset % snapshotAlignment) % snapshotAlignment;
+		if (rw) {
+			static const char zeros[snapshotAlignment] = { };
+			stream.Write(zeros, (unsigned int) padding);
+		} else {
+			stream.IgnoreBytes((unsigned int) padding);
+		}
+	}
+
+	bool State::serializeSnapshotComps(bool rw, BitStream &stream, size_t start, const std::vector<bool> *excluded) {
+		bool ok = true;
+		// SNAPSHOT EACH SERIALIZABLE COMPONENT COLLECTION APPEARS HERE
+		return ok;
+	}
+
+	void State::fireSnapshotCallbacks(const std::vector<entityId> &ids, const std::vector<Existence> &existences) {
+		// FIRE SNAPSHOT CALLBACKS FOR EACH SERIALIZABLE COMPONENT TYPE APPEARS HERE
+	}
 	
 
   CompOpReturn State::createEntity(entityId *newId) {
     entityId id;
-    if (freedIds.empty()) {
-      if (nextId == std::numeric_limits<entityId>::max() || ++nextId == std::numeric_limits<entityId>::max()) {
+    if (freeSlotHead) { // pop the most recently freed slot off the free list
+      entityId index = freeSlotHead;
+      freeSlotHead = entityIndex(entitySlots[index]);
+      id = makeEntityId(index, entityGeneration(entitySlots[index]));
+      entitySlots[index] = id;
+    } else {
+      if ( ! hasFreshSlots(1)) {
         if (newId) {
           *newId = 0; // ID 0 is not a valid id - ids start at 1.
         }
         return MAX_ID_REACHED;
       }
-      id = nextId;
-    } else {
-      id = freedIds.top();
-      freedIds.pop();
+      id = makeEntityId(entitySlots.size(), 0);
+      entitySlots.push_back(id);
     }
     Existence *existence = &comps_Existence[id];
     existence->turnOnFlags(Existence::flag);
+#ifdef EZECS_ARCHETYPES
+    archetypes.insert(id);
+#endif
+#ifdef EZECS_PROFILING
+    ++profileOf<Existence>().additions;
+#endif
     if (newId) {
       *newId = id;
     }
     return SUCCESS;
   }
 
+  CompOpReturn State::createEntityAt(const entityId& id) {
+    entityId index = entityIndex(id);
+    if ( ! index) {
+      return MAX_ID_REACHED;
+    }
+    while (entitySlots.size() <= index) { // slots skipped over become free
+      entitySlots.push_back(makeEntityId(freeSlotHead, 0));
+      freeSlotHead = entitySlots.size() - 1;
+    }
+    if (entityIndex(entitySlots[index]) == index) { // an occupied slot holds an ID with its own index
+      return REDUNDANT;
+    }
+    entityId next = entityIndex(entitySlots[index]);
+    if (freeSlotHead == index) {
+      freeSlotHead = next;
+    } else {
+      entityId previous = freeSlotHead;
+      while (entityIndex(entitySlots[previous]) != index) {
+        previous = entityIndex(entitySlots[previous]);
+      }
+      entitySlots[previous] = makeEntityId(next, entityGeneration(entitySlots[previous]));
+    }
+    entitySlots[index] = id;
+    Existence *existence = &comps_Existence[id];
+    existence->turnOnFlags(Existence::flag);
+#ifdef EZECS_ARCHETYPES
+    archetypes.insert(id);
+#endif
+#ifdef EZECS_PROFILING
+    ++profileOf<Existence>().additions;
+#endif
+    return SUCCESS;
+  }
+
+  CompOpReturn State::createEntities(size_t count, std::span<entityId> newIds) {
+    if ( ! hasFreshSlots(count)) {
+      return MAX_ID_REACHED; // a contiguous range of never-used slots is needed (freed slots are left to createEntity)
+    }
+    entityId firstIndex = entitySlots.size();
+    entitySlots.reserve(entitySlots.size() + count);
+    comps_Existence.reserve(comps_Existence.size() + count);
+    for (entityId index = firstIndex; index < firstIndex + count; ++index) {
+      entityId id = makeEntityId(index, 0);
+      entitySlots.push_back(id);
+      comps_Existence[id].turnOnFlags(Existence::flag);
+#ifdef EZECS_ARCHETYPES
+      archetypes.insert(id);
+#endif
+      if (index - firstIndex < newIds.size()) {
+        newIds[index - firstIndex] = id;
+      }
+    }
+#ifdef EZECS_PROFILING
+    profileOf<Existence>().additions += count;
+#endif
+    return SUCCESS;
+  }
+
+  template<typename ... compTypes>
+  void State::clearComps(const entityId& id, compMask present, CompTypeList<compTypes...>) {
+    // Only the types that are present are touched, with dependents going before their prerequisites
+    ((present & compTypes::flag ? (void) remCompNoChecks(collectionOf(static_cast<compTypes*>(nullptr)), id,
+                                                          remCallbacksOf(static_cast<compTypes*>(nullptr))) : (void) 0),
+     ...);
+  }
+
   CompOpReturn State::clearEntity(const entityId& id) {
     Existence* existence;
     CompOpReturn status = getExistence(id, &existence);
@@ -214,8 +576,9 @@ namespace ezecs {
       return NONEXISTENT_ENT; // only fail status possible here indicates no existence component, hence no entity.
     }
 
-    // A LOOP TO CLEAR ALL COMPONENTS APPEARS HERE
+    clearComps(id, existence->componentsPresent, TeardownOrder());
 
+    existence = comps_Existence.find(id); // removal delegates may have moved it
     if (existence->componentsPresent != Existence::flag) {
       return SOMETHING_REALLY_BAD;
     }
@@ -228,14 +591,202 @@ namespace ezecs {
       return cleared;
     }
     comps_Existence.erase(id);
-    freedIds.push(id);
+#ifdef EZECS_ARCHETYPES
+    archetypes.erase(id);
+#endif
+    // The freed slot remembers the next generation and links to the previous head of the free list.
+    entitySlots[entityIndex(id)] = makeEntityId(freeSlotHead, entityGeneration(id) + 1);
+    freeSlotHead = entityIndex(id);
+#ifdef EZECS_PROFILING
+    ++profileOf<Existence>().removals;
+#endif
     return SUCCESS;
   }
 
-  void State::listenForLikeEntities(const compMask& likeness,
-                                    EntNotifyDelegate&& additionDelegate, EntNotifyDelegate&& removalDelegate)
+  template<typename ... compTypes>
+  void State::fireTeardownCallbacks(const std::vector<std::pair<entityId, compMask>>& doomed,
+                                    CompTypeList<compTypes...>) {
+    // Going one at a time, a listener would fire when the first of the types it cares about is removed, so here
+    // it fires with the first such type in teardown order.
+    compMask removed = NONE;
+    auto fireFor = [&](auto* type) {
+      typedef std::remove_pointer_t<decltype(type)> compType;
+      for (auto &group : remCallbacksOf(type)) {
+        if (group.likeness & removed) {
+          continue;
+        }
+        for (auto &entity : doomed) {
+          if (hasAll(entity.second, group.likeness)) {
+            group.fire(entity.first);
+#ifdef EZECS_PROFILING
+            profileOf<compType>().removalFires += group.delegates.size();
+#endif
+          }
+        }
+      }
+      removed |= compType::flag;
+    };
+    (fireFor(static_cast<compTypes*>(nullptr)), ...);
+  }
+
+  template<typename ... compTypes>
+  void State::fireUnclearedCallbacks(const std::vector<std::pair<entityId, compMask>>& doomed,
+                                     const std::unordered_set<listenerHandle>& cleared, CompTypeList<compTypes...>) {
+    // As fireTeardownCallbacks does, but skipping the listeners that hear about clear() through their clear callback
+    compMask removed = NONE;
+    auto fireFor = [&](auto* type) {
+      typedef std::remove_pointer_t<decltype(type)> compType;
+      for (auto &group : remCallbacksOf(type)) {
+        if (group.likeness & removed) {
+          continue;
+        }
+        std::vector<EntNotifyDelegate> uncleared;
+        for (auto &dlgt : group.delegates) {
+          if ( ! cleared.count(dlgt.handle)) {
+            uncleared.push_back(dlgt);
+          }
+        }
+        for (auto &entity : doomed) {
+          if ( ! uncleared.empty() && hasAll(entity.second, group.likeness)) {
+            for (auto &dlgt : uncleared) {
+              dlgt.fire(entity.first);
+            }
+#ifdef EZECS_PROFILING
+            profileOf<compType>().removalFires += uncleared.size();
+#endif
+          }
+        }
+      }
+      removed |= compType::flag;
+    };
+    (fireFor(static_cast<compTypes*>(nullptr)), ...);
+  }
+
+  template<typename ... compTypes>
+  void State::eraseComps(const std::vector<std::pair<entityId, compMask>>& doomed, CompTypeList<compTypes...>) {
+    auto eraseFrom = [&](auto* type) {
+      typedef std::remove_pointer_t<decltype(type)> compType;
+      auto &coll = collectionOf(type);
+      for (auto &entity : doomed) {
+        if (entity.second & compType::flag) {
+          coll.erase(entity.first);
+#ifdef EZECS_PROFILING
+          ++profileOf<compType>().removals;
+#endif
+        }
+      }
+    };
+    (eraseFrom(static_cast<compTypes*>(nullptr)), ...);
+  }
+
+  CompOpReturn State::deleteEntities(std::span<const entityId> ids) {
+    EZECS_PROFILE_SCOPE("State::deleteEntities", "state");
+    CompOpReturn result = SUCCESS;
+    std::vector<std::pair<entityId, compMask>> doomed; // with the components each entity has
+    doomed.reserve(ids.size());
+    for (auto &id : ids) {
+      Existence* existence = comps_Existence.find(id);
+      if (existence) {
+        doomed.emplace_back(id, existence->componentsPresent);
+      } else {
+        result = NONEXISTENT_ENT;
+      }
+    }
+    std::sort(doomed.begin(), doomed.end(), [](const std::pair<entityId, compMask> &a,
+                                               const std::pair<entityId, compMask> &b) { return a.first < b.first; });
+    doomed.erase(std::unique(doomed.begin(), doomed.end(), [](const std::pair<entityId, compMask> &a,
+                                                              const std::pair<entityId, compMask> &b) {
+      return a.first == b.first;
+    }), doomed.end());
+
+    fireTeardownCallbacks(doomed, TeardownOrder());
+    eraseComps(doomed, TeardownOrder());
+    for (auto entity = doomed.rbegin(); entity != doomed.rend(); ++entity) { // so the lowest index is re-used first
+      comps_Existence.erase(entity->first);
+#ifdef EZECS_ARCHETYPES
+      archetypes.erase(entity->first);
+#endif
+      entitySlots[entityIndex(entity->first)] = makeEntityId(freeSlotHead, entityGeneration(entity->first) + 1);
+      freeSlotHead = entityIndex(entity->first);
+    }
+#ifdef EZECS_PROFILING
+    profileOf<Existence>().removals += doomed.size();
+#endif
+    return result;
+  }
+
+  listenerHandle State::listenForLikeEntities(const compMask& likeness,
+                                              EntNotifyDelegate&& additionDelegate, EntNotifyDelegate&& removalDelegate)
   {
+    listenerHandle handle = nextListenerHandle++;
+    additionDelegate.handle = removalDelegate.handle = handle;
+    listenerLikenesses.emplace(handle, likeness);
     // CODE TO REGISTER THE APPROPRIATE CALLBACKS APPEARS HERE
+    return handle;
+  }
+
+  listenerHandle State::listenForLikeEntities(const compMask& likeness, EntNotifyDelegate&& additionDelegate,
+                                              EntNotifyDelegate&& removalDelegate, ClearNotifyDelegate&& clearDelegate)
+  {
+    listenerHandle handle = listenForLikeEntities(likeness, std::move(additionDelegate), std::move(removalDelegate));
+    clearDelegate.handle = handle;
+    clearCallbacks.push_back(clearDelegate);
+    return handle;
+  }
+
+  void State::stopListening(const listenerHandle& handle) {
+    clearCallbacks.erase(std::remove_if(clearCallbacks.begin(), clearCallbacks.end(),
+                                        [&handle](const ClearNotifyDelegate &dlgt) { return dlgt.handle == handle; }),
+                         clearCallbacks.end());
+    auto found = listenerLikenesses.find(handle);
+    if (found == listenerLikenesses.end()) {
+      return;
+    }
+    compMask likeness = found->second;
+    listenerLikenesses.erase(found);
+    // CODE TO UNREGISTER THE APPROPRIATE CALLBACKS APPEARS HERE
+  }
+
+  void State::restoreEntitySlots(const std::vector<entityId> &ids, const std::vector<entityId> &slots) {
+    if (slots.size() > entitySlots.size()) {
+      entitySlots.resize(slots.size(), 0); // the new slots are free, and get linked in below
+    }
+    // Free slots take on the later of the two generations, so that IDs deleted on either side stay invalid
+    for (size_t index = 1; index < slots.size(); ++index) {
+      entityId &slot = entitySlots[index];
+      if (entityIndex(slot) != index && entityGeneration(slots[index]) > entityGeneration(slot)) {
+        slot = makeEntityId(entityIndex(slot), entityGeneration(slots[index]));
+      }
+    }
+    for (auto id : ids) {
+      size_t index = entityIndex(id);
+      if (index >= entitySlots.size()) {
+        entitySlots.resize(index + 1, 0);
+      }
+      entitySlots[index] = id;
+    }
+    rebuildFreeList();
+  }
+
+  void State::rebuildFreeList() {
+    // Linked from the top down, so that the lowest free indices get used first
+    freeSlotHead = 0;
+    for (size_t index = entitySlots.size() - 1; index > 0; --index) {
+      if (entityIndex(entitySlots[index]) != index) {
+        entitySlots[index] = makeEntityId(freeSlotHead, entityGeneration(entitySlots[index]));
+        freeSlotHead = index;
+      }
+    }
+  }
+
+  listenerHandle State::listenForClear(ClearNotifyDelegate&& clearDelegate) {
+    clearDelegate.handle = nextListenerHandle++;
+    clearCallbacks.push_back(clearDelegate);
+    return clearDelegate.handle;
+  }
+
+  bool State::isAlive(const entityId& id) const {
+    return id && entityIndex(id) < entitySlots.size() && entitySlots[entityIndex(id)] == id;
   }
 
   compMask State::getComponents(const entityId& id) {
@@ -246,10 +797,56 @@ namespace ezecs {
     return 0; // does not return compOpReturn, so a 0 indicates no components (even existence) present.
   }
 
+  changeTick State::advanceChangeTick() {
+    return currentTick++;
+  }
+
+  changeTick State::getChangeTick() const {
+    return currentTick;
+  }
+
   entityId State::getNextId() {
-    return nextId;
+    return entitySlots.size() - 1;
+  }
+
+#ifdef EZECS_ARCHETYPES
+	ArchetypeStorage &State::getArchetypes() {
+		return archetypes;
+	}
+#endif
+
+#ifdef EZECS_PROFILING
+  template<typename ... compTypes>
+  void State::publishProfiles(CompTypeList<compTypes...>) {
+    Profiler &profiler = Profiler::shared();
+    auto publishOne = [&](auto* type) {
+      typedef std::remove_pointer_t<decltype(type)> compType;
+      std::string name = CompTraits<compType>::name;
+      size_t count = collectionOf(type).size();
+      const CompProfile &profile = profileOf<compType>();
+      publishf("prof", "%s: %zu components (%zu bytes), %llu additions, %llu removals, %llu + %llu delegates fired\n",
+               name.c_str(), count, count * (sizeof(entityId) + sizeof(compType)),
+               (unsigned long long) profile.additions, (unsigned long long) profile.removals,
+               (unsigned long long) profile.additionFires, (unsigned long long) profile.removalFires);
+      profiler.recordCounter(name + " components", count);
+      profiler.recordCounter(name + " additions", profile.additions);
+      profiler.recordCounter(name + " removals", profile.removals);
+      profiler.recordCounter(name + " delegates fired", profile.additionFires + profile.removalFires);
+    };
+    (publishOne(static_cast<compTypes*>(nullptr)), ...);
+  }
+
+  void State::publishProfile() {
+    publishf("prof", "%zu entities\n", comps_Existence.size());
+    Profiler::shared().recordCounter("entities", comps_Existence.size());
+    publishProfiles(AllCompTypes());
   }
 
+  void State::resetProfile() {
+    compProfiles.fill(CompProfile());
+  }
+#endif
+
 	KvMap<entityId, Existence> State::getDump() const {
   	return comps_Existence;
   }
@@ -257,133 +854,309 @@ namespace ezecs {
 		return comps_Existence;
 	}
 
+  template<typename ... compTypes>
+  void State::gatherPersistent(std::vector<entityId>& kept, CompTypeList<compTypes...>) {
+    auto gatherFrom = [&](auto* type) {
+      typedef std::remove_pointer_t<decltype(type)> compType;
+      if constexpr (CompTraits<compType>::persistent) {
+        for (auto &&pair : collectionOf(type)) {
+          kept.push_back(pair.first);
+        }
+      }
+    };
+    (gatherFrom(static_cast<compTypes*>(nullptr)), ...);
+    std::sort(kept.begin(), kept.end());
+    kept.erase(std::unique(kept.begin(), kept.end()), kept.end());
+  }
+
+  template<typename ... compTypes>
+  void State::resetCollections(const std::vector<entityId>& kept, const compMask& keptComps,
+                               CompTypeList<compTypes...>) {
+    // The components of the kept entities are set aside, and everything else goes with the collections.
+    std::tuple<std::vector<std::tuple<entityId, compTypes, changeTick>>...> survivors;
+    auto setAside = [&](auto* type) {
+      typedef std::remove_pointer_t<decltype(type)> compType;
+      auto &coll = collectionOf(type);
+      auto &aside = std::get<std::vector<std::tuple<entityId, compType, changeTick>>>(survivors);
+      if (keptComps & compType::flag) {
+        for (auto &id : kept) {
+          compType* comp = coll.find(id);
+          if (comp) {
+            changeTick tick = 0;
+            if constexpr ( ! std::is_same<compType, Existence>::value) {
+              tick = changesOf(type).lastChanged(id);
+            }
+            aside.emplace_back(id, std::move(*comp), tick);
+          }
+        }
+      }
+#ifdef EZECS_PROFILING
+      profileOf<compType>().removals += coll.size() - aside.size();
+#endif
+    };
+    auto resetOne = [&](auto* type) {
+      typedef std::remove_pointer_t<decltype(type)> compType;
+      auto &coll = collectionOf(type);
+      coll.clear();
+      if constexpr ( ! std::is_same<compType, Existence>::value) {
+        changesOf(type).clear();
+      }
+      for (auto &survivor : std::get<std::vector<std::tuple<entityId, compType, changeTick>>>(survivors)) {
+        coll.insert(std::get<0>(survivor), std::move(std::get<1>(survivor)));
+        if constexpr ( ! std::is_same<compType, Existence>::value) {
+          if (std::get<2>(survivor)) {
+            changesOf(type).mark(std::get<0>(survivor), std::get<2>(survivor));
+          }
+        }
+      }
+    };
+    (setAside(static_cast<compTypes*>(nullptr)), ...);
+#ifdef EZECS_ARCHETYPES
+    archetypes.clear(); // every type's components go at once, and the kept entities get theirs back below
+    for (auto &id : kept) {
+      archetypes.insert(id);
+    }
+#endif
+    (resetOne(static_cast<compTypes*>(nullptr)), ...);
+  }
+
   void State::clear() {
-    std::vector<entityId> idsToErase;
-    for (auto pair : comps_Existence) {
-    	if ( ! (pair.second.componentsPresent & persistenceMask)) {
-		    idsToErase.push_back(pair.first);
-    	}
+    EZECS_PROFILE_SCOPE("State::clear", "state");
+    // Listeners with no clear callback are told of each entity they lose, as deleteEntities would tell them, while the
+    // entities still exist. Only then is anything worked out, since those callbacks may change what there is.
+    std::unordered_set<listenerHandle> cleared;
+    for (auto &dlgt : clearCallbacks) {
+      cleared.insert(dlgt.handle);
+    }
+    if (std::any_of(listenerLikenesses.begin(), listenerLikenesses.end(),
+                    [&cleared](const std::pair<const listenerHandle, compMask> &listener) {
+                      return ! cleared.count(listener.first);
+                    })) {
+      std::vector<std::pair<entityId, compMask>> doomed;
+      for (auto &&pair : comps_Existence) {
+        if ( ! (pair.second.componentsPresent & persistenceMask)) {
+          doomed.emplace_back(pair.first, pair.second.componentsPresent);
+        }
+      }
+      fireUnclearedCallbacks(doomed, cleared, TeardownOrder());
     }
-    for (auto id : idsToErase) {
-      deleteEntity(id);
+
+    // Persistent entities are found through the collections of the persistent types, which are usually small, so
+    // nothing here walks every entity.
+    std::vector<entityId> kept;
+    gatherPersistent(kept, AllCompTypes());
+    compMask keptComps = NONE;
+    for (auto &id : kept) {
+      keptComps |= comps_Existence.at(id).componentsPresent;
     }
-  }
-  
-  template<typename compType>
-  inline CompOpReturn State::remCompNoChecks(KvMap<entityId, compType>& coll, Existence* existence,
-                                                      const entityId& id, const EntNotifyDelegates& callbacks)
-  {
-    for (auto dlgt : callbacks) {
-      if (shouldFireRemovalDlgt(dlgt.likeness, existence->componentsPresent, compType::flag)) {
-        dlgt.fire(id);
+    if (kept.size() != comps_Existence.size()) {
+      resetCollections(kept, keptComps, AllCompTypes());
+    }
+
+    // Every slot but those of the kept entities is freed in one pass, linked from the top down like rebuildFreeList
+    // does, and those that held an entity move on to the next generation.
+    std::vector<bool> keptSlots(entitySlots.size());
+    for (auto &id : kept) {
+      keptSlots[entityIndex(id)] = true;
+    }
+    freeSlotHead = 0;
+    for (size_t index = entitySlots.size() - 1; index > 0; --index) {
+      if (keptSlots[index]) {
+        continue;
       }
+      entityId &slot = entitySlots[index];
+      entityId generation = entityGeneration(slot) + (entityIndex(slot) == index ? 1 : 0);
+      slot = makeEntityId(freeSlotHead, generation);
+      freeSlotHead = index;
+    }
+
+    for (auto &dlgt : clearCallbacks) {
+      dlgt.fire(*this);
     }
-    coll.erase(id);
-    existence->turnOffFlags(compType::flag);
-    return SUCCESS;
   }
 
-  template<typename compType, typename ... types>
-  inline CompOpReturn State::addComp(KvMap<entityId, compType>& coll, const entityId& id,
-                                     const EntNotifyDelegates& callbacks, const types &... args)
-  {
-	  if (comps_Existence.count(id)) {
-		  Existence* existence = &comps_Existence.at(id);
-		  if (existence->passesPrerequisitesForAddition(compType::requiredComps)) {
-			  bool wasEmplaced = coll.try_emplace(id, args...);
-		  	if (wasEmplaced) {
-				  for (auto dlgt : callbacks) {
-					  if (shouldFireAdditionDlgt(dlgt.likeness, existence->componentsPresent, compType::flag)) {
-						  dlgt.fire(id);
-					  }
-				  }
-				  existence->turnOnFlags(compType::flag);
-				  return SUCCESS;
-		  	}
-			  return REDUNDANT;
-		  }
-		  return PREREQ_FAIL;
-	  }
-	  return NONEXISTENT_ENT;
+  template<typename ... compTypes>
+  void State::reportCollections(MemoryReport &report, CompTypeList<compTypes...>) {
+    auto reportOne = [&](auto* type) {
+      typedef std::remove_pointer_t<decltype(type)> compType;
+      auto &coll = collectionOf(type);
+      MemoryUsage usage = coll.memoryUsage();
+      if constexpr ( ! std::is_same<compType, Existence>::value) {
+        usage += changesOf(type).memoryUsage();
+        report.callbacks += addCallbacksOf(type).memoryUsage();
+        report.callbacks += remCallbacksOf(type).memoryUsage();
+      }
+      size_t &peak = collectionHighWater[CompTraits<compType>::index];
+      peak = std::max(peak, usage.total());
+      report.collections.push_back({ CompTraits<compType>::name, coll.size(), usage, peak });
+    };
+    (reportOne(static_cast<compTypes*>(nullptr)), ...);
   }
 
-	template<typename compType>
-	inline CompOpReturn State::insertComp(KvMap<entityId, compType>& coll, const entityId& id,
-	                                      const EntNotifyDelegates& callbacks, compType && input)
-	{
-		if (comps_Existence.count(id)) {
-			Existence* existence = &comps_Existence.at(id);
-			if (existence->passesPrerequisitesForAddition(compType::requiredComps)) {
-				bool wasInserted = coll.insert(id, std::forward<compType>(input));
-				if (wasInserted) {
-					for (auto dlgt : callbacks) {
-						if (shouldFireAdditionDlgt(dlgt.likeness, existence->componentsPresent, compType::flag)) {
-							dlgt.fire(id);
-						}
-					}
-					existence->turnOnFlags(compType::flag);
-					return SUCCESS;
-				}
-				return REDUNDANT;
-			}
-			return PREREQ_FAIL;
-		}
-		return NONEXISTENT_ENT;
-	}
+  MemoryReport State::memoryReport() {
+    MemoryReport report;
+    reportCollections(report, AllCompTypes());
+    report.callbacks += MemoryUsage::of(clearCallbacks);
+    report.callbacks.overhead += listenerLikenesses.size() * sizeof(std::pair<const listenerHandle, compMask>)
+                                 + listenerLikenesses.bucket_count() * sizeof(void*);
+    report.entities = MemoryUsage::of(entitySlots, true);
+#ifdef EZECS_ARCHETYPES
+    report.entities += archetypes.memoryUsage();
+#endif
+    highWater = std::max(highWater, report.total().total());
+    report.highWater = highWater;
+    return report;
+  }
 
-  template<typename compType>
-  inline CompOpReturn State::remComp(KvMap<entityId, compType>& coll, const entityId& id,
-                                     const EntNotifyDelegates& callbacks)
-  {
-    if (comps_Existence.count(id)) {
-      if (coll.count(id)) {
-        Existence* existence = &comps_Existence.at(id);
-        if (existence->passesDependenciesForRemoval(compType::dependentComps)) {
-          return remCompNoChecks(coll, existence, id, callbacks);
+  template<typename ... compTypes>
+  void State::shrinkCollections(CompTypeList<compTypes...>) {
+    auto shrinkOne = [&](auto* type) {
+      typedef std::remove_pointer_t<decltype(type)> compType;
+      auto &coll = collectionOf(type);
+      coll.shrinkToFit();
+      if constexpr ( ! std::is_same<compType, Existence>::value) {
+        size_t end = 0; // past the highest entity index that still has one of these components
+        for (auto &&pair : coll) {
+          end = std::max(end, (size_t) entityIndex(pair.first) + 1);
         }
-        return DEPEND_FAIL;
+        changesOf(type).shrinkToFit(end);
+        addCallbacksOf(type).shrinkToFit();
+        remCallbacksOf(type).shrinkToFit();
       }
-      return NONEXISTENT_COMP;
-    }
-    return NONEXISTENT_ENT;
+    };
+    (shrinkOne(static_cast<compTypes*>(nullptr)), ...);
   }
 
-  template<typename compType>
-  inline CompOpReturn State::getComp(KvMap<entityId, compType> &coll, const entityId& id, compType** out) {
-    if (coll.count(id)) {
-      *out = &coll.at(id);
-      return SUCCESS;
+  void State::shrinkToFit() {
+    memoryReport(); // brings the high-water marks up to date before anything is given back
+    shrinkCollections(AllCompTypes());
+#ifdef EZECS_ARCHETYPES
+    archetypes.shrinkToFit();
+#endif
+    clearCallbacks.shrink_to_fit();
+    entitySlots.shrink_to_fit();
+  }
+  
+  template<typename compType, bool hasData>
+  inline bool State::snapshotComps(bool rw, BitStream &stream, size_t start, const uint64_t &schema,
+                                   const std::vector<bool> *excluded) {
+    auto &coll = collectionOf(static_cast<compType*>(nullptr));
+    constexpr bool raw = CompTraits<compType>::raw;
+    uint64_t check = schema ^ (raw ? sizeof(compType) : 0); // raw data is only any good with the same layout
+    uint64_t count = coll.size();
+    if (rw) {
+      // Collections are written straight from their storage, unless some entities have to be left out.
+      auto kept = [excluded](const entityId &id) { return ! excluded || ! (*excluded)[entityIndex(id)]; };
+      if (excluded) {
+        count = 0;
+        for (auto &&pair : coll) {
+          count += kept(pair.first);
+        }
+      }
+      stream.Write(check);
+      stream.Write(count);
+      padSnapshot(true, stream, start);
+      auto packed = packedData(coll);
+      if (packed.first && ! excluded) {
+        stream.Write((const char*) packed.first, (unsigned int) (count * sizeof(entityId)));
+      } else {
+        for (auto &&pair : coll) {
+          if (kept(pair.first)) {
+            stream.Write(pair.first);
+          }
+        }
+      }
+      if constexpr (hasData) {
+        padSnapshot(true, stream, start);
+        if constexpr (raw) {
+          if (packed.second && ! excluded) {
+            stream.Write((const char*) packed.second, (unsigned int) (count * sizeof(compType)));
+          } else {
+            for (auto &&pair : coll) {
+              if (kept(pair.first)) {
+                stream.Write((const char*) &pair.second, (unsigned int) sizeof(compType));
+              }
+            }
+          }
+        } else {
+          for (auto &&pair : coll) {
+            if (kept(pair.first)) {
+              pair.second.serialize(stream);
+            }
+          }
+        }
+      }
+      return true;
+    }
+    uint64_t readCheck = 0;
+    if ( ! stream.Read(readCheck) || ! stream.Read(count) || readCheck != check) {
+      publish("err", "Snapshot component block does not match the component's definition!");
+      return false;
     }
-    *out = NULL; // hopefully a null pointer exception will catch some bugs if somebody uses this wrong.
-    return NONEXISTENT_COMP;
+    if (count > entityIndexMask || count * sizeof(entityId) > stream.GetNumberOfUnreadBits() / 8) {
+      publish("err", "Snapshot component block is truncated or corrupt!");
+      return false;
+    }
+    std::vector<entityId> ids(count);
+    padSnapshot(false, stream, start);
+    if ( ! stream.Read((char*) ids.data(), (unsigned int) (count * sizeof(entityId)))) {
+      return false;
+    }
+    if constexpr ( ! hasData) {
+      std::vector<compType> values(count);
+      coll.insertBulk(ids.data(), values.data(), count);
+    } else if constexpr (raw) {
+      padSnapshot(false, stream, start);
+      std::allocator<compType> alloc;
+      compType *values = alloc.allocate(count);
+      bool ok = stream.Read((char*) values, (unsigned int) (count * sizeof(compType)));
+      if (ok) {
+        coll.insertBulk(ids.data(), values, count);
+      }
+      alloc.deallocate(values, count);
+      return ok;
+    } else {
+      padSnapshot(false, stream, start);
+      std::vector<compType> values;
+      values.reserve(count);
+      for (uint64_t i = 0; i < count; ++i) {
+        values.push_back(compType::deserialize(stream));
+      }
+      coll.insertBulk(ids.data(), values.data(), count);
+    }
+    return true;
   }
 
-  inline bool State::shouldFireRemovalDlgt(const compMask& likeness, const compMask& current,
-                                           const compMask& typeRemoved)
-  {
-    if ( (likeness & current) == likeness ) {
-      if ( (likeness & ~typeRemoved) != likeness) {
-        return true;
+  template<typename compType>
+  inline void State::fireSnapshotCallbacks(const std::vector<entityId> &ids, const std::vector<Existence> &existences) {
+    ChangeTracker &changes = changesOf(static_cast<compType*>(nullptr));
+    for (size_t i = 0; i < ids.size(); ++i) {
+      if (existences[i].componentsPresent & compType::flag) {
+        changes.mark(ids[i], currentTick);
       }
     }
-    return false;
-  }
-  inline bool State::shouldFireAdditionDlgt(const compMask& likeness, const compMask& current,
-                                            const compMask& typeAdded)
-  {
-    if ( (likeness & current) != likeness) {
-      if ( (likeness & (current | typeAdded)) == likeness) {
-        return true;
+    // Each listener is registered with every type in its likeness, so only the list of its lowest type fires it.
+    for (auto &group : addCallbacksOf(static_cast<compType*>(nullptr))) {
+      compMask types = group.likeness & ~(compMask) EXISTENCE;
+      if (lowestFlag(types) != compType::flag) {
+        continue;
+      }
+      for (size_t i = 0; i < ids.size(); ++i) {
+        if (hasAll(existences[i].componentsPresent, group.likeness)) {
+          group.fire(ids[i]);
+        }
       }
     }
-    return false;
   }
 
   /*
    * Component collection manipulation method definitions
    */
-  CompOpReturn State::getExistence(const entityId& id, Existence** out) { return getComp(comps_Existence, id, out); }
+  CompOpReturn State::getExistence(const entityId& id, Existence** out) {
+    *out = comps_Existence.find(id);
+    return *out ? SUCCESS : NONEXISTENT_COMP;
+  }
 
-  // COMPONENT COLLECTION MANIPULATION METHOD DEFINITIONS APPEAR HERE
+  // The methods of the generated component types are spread over ecsState.<n>.generated.cpp (see ecsStateUnit.cpp).
 
 }
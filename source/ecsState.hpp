@@ -23,23 +23,72 @@
 
 #pragma once
 
-#include <stack>
+#include <algorithm>
+#include <array>
 #include <functional>
+#include <span>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 #include "ecsComponents.generated.hpp"
 #include "delegate.hpp"
 #include "ecsKvMap.hpp"
+#include "ecsArchetypes.hpp"
+#include "ecsChangeTracker.hpp"
+#include "ecsRelevancy.hpp"
+#include "ecsMappedFile.hpp"
+#include "ecsMemory.hpp"
+#include "ecsProfiler.hpp"
 #include "netInterface.hpp"
 
 namespace ezecs {
 
+  /*
+   * Every listener registered through State::listenForLikeEntities or State::listenForClear gets a handle, which can be
+   * given to State::stopListening to unregister it. 0 is never a valid handle.
+   */
+  typedef uint32_t listenerHandle;
+
   struct EntNotifyDelegate {
     rtu::Delegate<void(const entityId&, void* data)> dlgt;
     compMask likeness;
     void* data;
+    listenerHandle handle = 0;
     inline void fire(const entityId& id) { dlgt(id, data); }
   };
-  typedef std::vector<EntNotifyDelegate> EntNotifyDelegates;
+
+  /*
+   * EntNotifyDelegates holds the listeners of one component type, grouped by likeness. When a component of that type
+   * comes or goes, whether that matters to a likeness is worked out once, and then every listener in the group fires.
+   */
+  struct EntNotifyGroup {
+    compMask likeness;
+    std::vector<EntNotifyDelegate> delegates;
+    inline void fire(const entityId& id);
+  };
+  class EntNotifyDelegates {
+    public:
+      void push_back(const EntNotifyDelegate& dlgt);
+      void remove(const listenerHandle& handle);
+      std::vector<EntNotifyGroup>::iterator begin() { return groups.begin(); }
+      std::vector<EntNotifyGroup>::iterator end() { return groups.end(); }
+      bool empty() const { return groups.empty(); }
+      MemoryUsage memoryUsage() const;
+      void shrinkToFit();
+    private:
+      std::vector<EntNotifyGroup> groups;
+  };
+
+  class State;
+  struct ClearNotifyDelegate {
+    rtu::Delegate<void(const State& state, void* data)> dlgt;
+    void* data;
+    listenerHandle handle = 0;
+    inline void fire(const State& state) { dlgt(state, data); }
+  };
 
   /**
    * Component Operation Return Values
@@ -63,6 +112,8 @@ namespace ezecs {
    * components themselves. Entities per se only exist as associations between components that share the same ID.
    */
   class State {
+      friend class EntityCommandBuffer;
+
       /**
        * Here appear collections of each type of component, as well as methods to access and modify each collection.
        * These methods are formatted as follows (examples given for imaginary component 'FakeComponent'):
@@ -76,6 +127,13 @@ namespace ezecs {
        *                      to be made (i.e. if you tried to give it a velocity before giving it a position),
        *          NONEXISTENT_ENT if no entity exists at that ID to which to add the requested component.
        *
+       * * * BULK COMPONENT ADDITION * * *
+       * SYNTAX:  CompOpReturn add[component_name]Bulk(std::span<const entityId> ids, [applicable constructor arguments])
+       * EXAMPLE: CompOpReturn result = addFakeComponentBulk(someIds, madeUpConstructorArgument);
+       * RETURNS: SUCCESS if the component was added to every entity, or otherwise the first failure (as above). The
+       *          component is still added to all of the entities for which it can be. Addition callbacks are fired
+       *          once all of the components are in place.
+       *
        * * * COMPONENT REMOVAL * * *
        * SYNTAX:  CompOpReturn rem[component_name](entityId id)
        * EXAMPLE: CompOpReturn result = remFakeComponent(someId);
@@ -89,10 +147,27 @@ namespace ezecs {
        * Example: CompOpReturn result = getFakeComponent(someId, FakeComponent** myPtr);
        * RETURNS: SUCCESS,
        *          NONEXISTENT_COMP if the component you're trying to access doesn't exist at that ID.
+       *
+       * * * MUTABLE COMPONENT RETREIVAL * * *
+       * SYNTAX:  CompOpReturn get[component_name]Mut(entityId id, [component_name]** out)
+       * EXAMPLE: CompOpReturn result = getFakeComponentMut(someId, FakeComponent** myPtr);
+       * RETURNS: the same as get[component_name], but also marks the component as changed at the current change tick
+       *          (see advanceChangeTick), so use this whenever you intend to modify the component.
+       *
+       * NOTE: With EZECS_SPARSE_STORAGE (off by default), components of one type are packed together in memory, so a
+       * pointer retrieved this way is only valid until the next addition or removal of a component of that type. With
+       * EZECS_ARCHETYPES, components are stored by archetype (see ecsArchetypes.hpp), so it is only valid until the
+       * next addition or removal of any component.
        */
 
       KvMap<entityId, Existence> comps_Existence;
+#ifdef EZECS_ARCHETYPES
+      ArchetypeStorage archetypes;
+#endif
       CompOpReturn getExistence(const entityId& id, Existence** out);
+      KvMap<entityId, Existence>& collectionOf(Existence*) { return comps_Existence; }
+      template<typename compType>
+      CompCollection<compType> makeCollection();
 
       // COMPONENT COLLECTION AND MANIPULATION METHOD DECLARATIONS APPEAR HERE
 
@@ -122,14 +197,105 @@ namespace ezecs {
 		  entityId serializeEntityDeletionRequest(bool rw, SLNet::BitStream &stream, entityId id = 0);
 		  bool hasComponent(bool rw, SLNet::BitStream &stream, const entityId &id, const compMask &type);
 
+		  /**
+		   * Server side: sends every connected client the serializable components that have changed (see
+		   * advanceChangeTick) since the last delta that client acknowledged, on CH_SIMULATION_UPDATE. A client that has
+		   * acknowledged nothing yet gets everything. Lost deltas need no resending, since the next one covers their
+		   * changes too. Call this once per network tick.
+		   * With a Relevancy set (see setRelevancy), each client instead only hears about the entities relevant to it.
+		   * Those that have become relevant are sent whole and those that have stopped being relevant are deleted,
+		   * reliably on CH_ECS_UPDATE, before the client's delta is sent.
+		   * NOTE: Component removals are not replicated. Only additions and changes are.
+		   */
+		  void replicateDeltas();
+
+		  /**
+		   * Limits replication to the entities relevant to each client. Entity creation and deletion are then no longer
+		   * broadcast as they happen, but sent by replicateDeltas to the clients they matter to.
+		   * @param relevancy is not owned by State and must outlive it, or nullptr to replicate everything to everyone
+		   */
+		  void setRelevancy(Relevancy *relevancy);
+
+		  /**
+		   * Handles the packets used by replicateDeltas: a client applies ID_SYNC_ECS_DELTA and acknowledges it, and the
+		   * server records each ID_SYNC_ECS_DELTA_ACK. Pass it each packet from NetInterface::getSyncPackets.
+		   * A component in a delta that the client's entity does not have is added to it. If that entity has not been
+		   * created on the client yet, the delta is not acknowledged, so that its changes are sent again.
+		   * @return true if the packet was one of these
+		   */
+		  bool handleDeltaPacket(SLNet::Packet *packet);
+
+		  /**
+		   * Writes every entity and its serializable components as a snapshot: one contiguous block of IDs and component
+		   * data per component type, tagged with a hash of the type's definition. Components with the raw attribute
+		   * are copied as plain memory, and the rest go through their serialize methods. Use this instead of one
+		   * creation request per entity for CMD_WORLD_INIT when a client joins, or to save a game (see saveSnapshot).
+		   * Entities with persistent components are left out, since they hold data for the lifetime of the program
+		   * rather than of the world (see EZECS_COMPONENT_ATTRIBS).
+		   */
+		  void writeSnapshot(SLNet::BitStream &stream);
+
+		  /**
+		   * Reads a snapshot written by writeSnapshot, creating its entities with the same IDs and bulk-inserting their
+		   * components. Entities that already exist are kept, and addition callbacks fire as if the components had been
+		   * added one by one.
+		   * @return false if the snapshot is truncated or corrupt, or if it was written with a different component
+		   * configuration or any of its entities would take the slot of an existing entity (or of another of its
+		   * entities). Problems with the header or the entities are found before anything is changed, but component
+		   * blocks are read straight into their collections, so one that turns out to be bad leaves the snapshot's
+		   * entities in place with only the components read before it.
+		   */
+		  bool readSnapshot(SLNet::BitStream &stream);
+
+		  /**
+		   * Writes or reads a snapshot as a file. Blocks in the file are aligned so that it can be memory-mapped.
+		   * @return false if the file could not be written or read, or (for loadSnapshot) readSnapshot failed
+		   */
+		  bool saveSnapshot(const std::string &path);
+		  bool loadSnapshot(const std::string &path);
+
+		  /**
+		   * Keeps the persistent entities (those with a persistent component, see EZECS_COMPONENT_ATTRIBS) in a
+		   * memory-mapped file, so that a restarted program gets them back at once. If the file holds entities written
+		   * with the same component configuration, they are restored straight from the mapping, so call this before
+		   * creating any persistent entities. Only their serializable components are kept.
+		   * @return false if the file could not be mapped, or its entities could not be restored
+		   */
+		  bool mapPersistentStorage(const std::string &path);
+
+		  /**
+		   * Copies the persistent entities into the file given to mapPersistentStorage. Call it whenever they are worth
+		   * keeping, such as on an autosave interval. The operating system writes the pages out in the background.
+		   */
+		  void syncPersistentStorage();
+
       /**
        * Creates a new entity (specifically an Existence component).
        * If newId is nullptr (0), it will not be written to (naturally), and you won't get the ID back out.
        * @param newId is set to the id of the newly created entity, or 0 if unsuccessful.
-       * @return SUCCESS or MAX_ID_REACHED if the maximum value of the entityId type has been reached
+       * @return SUCCESS or MAX_ID_REACHED if every entity index (see entityIndexBits) is in use, so that at most
+       * entityIndexMask entities can be alive at once
        */
       CompOpReturn createEntity(entityId* newId = nullptr);
 
+      /**
+       * Creates an entity with a specific ID, such as one chosen by a server. Any unused slots below it are freed, and
+       * the slot is taken out of the free list, which takes time proportional to the length of the free list.
+       * @param id The ID that the new entity should have
+       * @return SUCCESS, REDUNDANT if the slot is already occupied, or MAX_ID_REACHED if the ID is invalid
+       */
+      CompOpReturn createEntityAt(const entityId& id);
+
+      /**
+       * Creates many new entities at once, with storage reserved up front and IDs taken from one contiguous range.
+       * Pair this with the add[component_name]Bulk methods to spawn lots of similar entities quickly.
+       * @param count The number of entities to create
+       * @param newIds If not empty, receives the IDs of the new entities (as many as fit)
+       * @return SUCCESS, or MAX_ID_REACHED (having created nothing) if there is no free range that large, including
+       * when the range would run past entityIndexMask
+       */
+      CompOpReturn createEntities(size_t count, std::span<entityId> newIds = {});
+
       /**
        * Deletes all existing components from an entity except the Existence component
        * @param id The entity ID of the entity you wish to clear
@@ -138,21 +304,65 @@ namespace ezecs {
       CompOpReturn clearEntity(const entityId& id);
 
       /**
-       * Deletes an entity. It's ID may be re-used later, so this 'invalidates' the ID
+       * Deletes an entity. Its slot may be re-used later under a new generation, so this 'invalidates' the ID
        * @param id The entity ID of the entity you wish to delete
        * @return any of the possible return values of remExistence given that ID (see above)
        */
       CompOpReturn deleteEntity(const entityId& id);
 
+      /**
+       * Deletes many entities at once, which is much faster than deleting them one by one. Removal callbacks are
+       * batched: each group of listeners fires for every entity that it cares about before the next group does, and
+       * all of them fire before any component is erased. Callbacks must not add or remove components, nor create or
+       * delete entities, while this runs.
+       * @param ids The IDs of the entities to delete (any given more than once are deleted once)
+       * @return SUCCESS, or NONEXISTENT_ENT if any of the IDs did not refer to an entity (the rest are still deleted)
+       */
+      CompOpReturn deleteEntities(std::span<const entityId> ids);
+
       /**
        * Use if you want to fire a callback whenever an entity with at least the components described by 'likeness'
        * comes into or leaves existence.
        * @param likeness The component mask describing all components necessary for an entity to trigger these callbacks
        * @param callback_add Pointer to the callback to fire when a qualifying entity appears
        * @param callback_rem Pointer to the callback to fire when such an entity ceases to qualify
+       * @return a handle that stopListening takes to unregister both callbacks
+       */
+      listenerHandle listenForLikeEntities(const compMask& likeness,
+                                           EntNotifyDelegate&& additionDelegate, EntNotifyDelegate&& removalDelegate);
+
+      /**
+       * As above, but clear() fires 'clearDelegate' once instead of firing the removal callback for each entity it
+       * deletes, which is much cheaper for a listener that can drop everything it knows at once (as Systems do). Without
+       * a clear callback, the removal callback fires for each of those entities before it is deleted.
+       * @return a handle that stopListening takes to unregister all three callbacks
+       */
+      listenerHandle listenForLikeEntities(const compMask& likeness, EntNotifyDelegate&& additionDelegate,
+                                           EntNotifyDelegate&& removalDelegate, ClearNotifyDelegate&& clearDelegate);
+
+      /**
+       * Use if you want to be told when clear() has deleted every entity but the persistent ones, so that you can drop
+       * everything you know about them at once. isAlive tells which entities are left. To hear about clear() in place of
+       * the removal callbacks of like entities, give the clear callback to listenForLikeEntities instead.
+       * @param clearDelegate The callback to fire
+       * @return a handle that stopListening takes to unregister the callback
+       */
+      listenerHandle listenForClear(ClearNotifyDelegate&& clearDelegate);
+
+      /**
+       * Unregisters the callbacks registered by a call to listenForLikeEntities or listenForClear. Systems do this for
+       * themselves when they are destroyed.
+       * @param handle The handle returned when the callbacks were registered
        */
-      void listenForLikeEntities(const compMask& likeness,
-                                 EntNotifyDelegate&& additionDelegate, EntNotifyDelegate&& removalDelegate);
+      void stopListening(const listenerHandle& handle);
+
+      /**
+       * Use to check whether an id refers to an entity that currently exists. An id of a deleted entity never does, even
+       * if its slot has since been re-used by a new entity.
+       * @param id
+       * @return true if the entity exists
+       */
+      bool isAlive(const entityId& id) const;
 
       /**
        * Use to get which components currently exist at an id (as a mask)
@@ -161,7 +371,86 @@ namespace ezecs {
        */
       compMask getComponents(const entityId& id);
 
+      /**
+       * Get the highest entity index handed out so far
+       */
       entityId getNextId();
+
+      /**
+       * Calls fn(const entityId &id) for every entity with at least the components described by 'likeness'.
+       * Do not add or remove components from within fn.
+       */
+      template<typename Fn>
+      void forEachLikeEntity(const compMask& likeness, Fn&& fn);
+
+      /**
+       * Calls fn(const entityId &id, compTypes&... comps) for every entity that has all of the listed component types,
+       * with references to each of those components. Only the smallest of the listed collections is walked, and the
+       * others are looked up by ID, so this is the fast way for a system to visit its entities. With EZECS_ARCHETYPES,
+       * the chunks of the matching archetypes are walked instead, going straight through their arrays of components.
+       * EXAMPLE: state.forEach<FakeComponent, OtherComponent>([](const entityId &id, FakeComponent &fake,
+       *                                                          OtherComponent &other) { ... });
+       * Do not add or remove components of the listed types from within fn (nor any components, with EZECS_ARCHETYPES).
+       */
+      template<typename ... compTypes, typename Fn>
+      void forEach(Fn&& fn);
+
+      /**
+       * Ends the current change tick and returns it. Anything added or accessed through a get[component_name]Mut method
+       * from now on counts as changed since the returned tick. A system that wants to see only what has changed since it
+       * last ran can keep the tick returned after each run and pass it to forEachChangedSince on the next.
+       */
+      changeTick advanceChangeTick();
+      changeTick getChangeTick() const;
+
+      /**
+       * Calls fn(const entityId &id, compType &comp) for every component of the given type that was added or accessed
+       * mutably after the given tick.
+       */
+      template<typename compType, typename Fn>
+      void forEachChangedSince(const changeTick& tick, Fn&& fn);
+
+      /**
+       * Get the change ticks of every component of a given type
+       */
+      template<typename compType>
+      const ChangeTracker& getChanges();
+
+      /**
+       * Get the collection holding every component of a given type, read only, since changes made through it would
+       * skip the flags, delegates and change ticks. Use the add, rem and get...Mut methods to change components.
+       */
+      template<typename compType>
+      const CompCollection<compType>& getCollection();
+
+#ifdef EZECS_ARCHETYPES
+      /**
+       * Get the storage that holds entities and their components grouped by archetype (by exact component mask), for
+       * chunked iteration.
+       */
+      ArchetypeStorage &getArchetypes();
+#endif
+
+#ifdef EZECS_PROFILING
+      /**
+       * Get the counts of additions, removals and delegate fires kept for a component type (see ecsProfiler.hpp) since
+       * the State was made or resetProfile was last called.
+       */
+      template<typename compType>
+      const CompProfile& getProfile();
+
+      /**
+       * Publishes, on the "prof" topic, how many components of each type exist and how many bytes they hold, along
+       * with the counts kept for that type. The same numbers are recorded as counters in Profiler::shared(), so
+       * calling this once per frame plots them alongside the timed spans in the trace.
+       */
+      void publishProfile();
+
+      /**
+       * Zeroes the counts of every component type
+       */
+      void resetProfile();
+#endif
       
       /**
        * Get a dump of all entities with their component masks
@@ -170,39 +459,281 @@ namespace ezecs {
 		  const KvMap<entityId, Existence> &getDumpRef() const;
 
       /**
-       * Deletes all entities
+       * Deletes every entity that has no persistent component (see EZECS_COMPONENT_ATTRIBS). Rather than deleting them
+       * one by one, the collections are reset wholesale around the persistent entities. Like-entity listeners that were
+       * given a clear callback hear about it through that alone, and the others through a removal callback per entity.
        */
       void clear();
 
+      /**
+       * Measures the memory held by each component collection (along with its change ticks), by the delegates of every
+       * listener and by the entity slots. A State does not know about systems, so use System::reportMemory to add
+       * their registries to the report.
+       * High-water marks are the most bytes held as of any call to memoryReport or shrinkToFit. Storage only grows
+       * until shrinkToFit gives it back (and shrinkToFit takes its measurements first), so they cover the times in
+       * between as well.
+       * @return the report
+       */
+      MemoryReport memoryReport();
+
+      /**
+       * Gives back the memory that collections, change trackers and listener delegates hold without using, such as
+       * after a lot of entities have been deleted. Pointers to components are invalidated. Entity slots are kept, since
+       * they remember the generations of deleted entities (see ecsTypes.hpp).
+       */
+      void shrinkToFit();
+
     private:
-      entityId nextId = 0;
-      std::stack<entityId> freedIds;
+      /*
+       * entitySlots holds, for each entity index, the ID of the entity living there. A free slot instead holds the
+       * index of the next free slot (forming a linked list that starts at freeSlotHead) along with the generation that
+       * the slot's next entity will have. Index 0 is never used, so a freeSlotHead of 0 means there are no free slots.
+       */
+      std::vector<entityId> entitySlots = { 0 };
+      entityId freeSlotHead = 0;
+      /*
+       * Whether 'count' never-used slots can still be appended without an index outgrowing entityIndexMask, which
+       * makeEntityId would otherwise silently wrap around onto slot 0 and the live slots after it.
+       */
+      bool hasFreshSlots(size_t count) const {
+        return entitySlots.size() <= size_t(entityIndexMask) && count <= size_t(entityIndexMask) + 1 - entitySlots.size();
+      }
+      std::vector<ClearNotifyDelegate> clearCallbacks;
+      std::unordered_map<listenerHandle, compMask> listenerLikenesses;
+      std::array<size_t, AllCompTypes::size> collectionHighWater = { };
+      size_t highWater = 0;
+      listenerHandle nextListenerHandle = 1;
+      changeTick currentTick = 1; // components that have never changed are at tick 0
+      std::unordered_map<uint64_t, changeTick> ackedTicks; // by client GUID
+      Relevancy *relevancy = nullptr;
+      MappedFile persistentStorage;
+
+      bool serializeDelta(bool rw, SLNet::BitStream &stream, const changeTick &since,
+                          const std::unordered_set<entityId> *relevant = nullptr);
+      void replicateRelevantTo(const SLNet::RakNetGUID &guid, const changeTick &since, const changeTick &sent);
+      static bool needsReplication(const ChangeTracker &changes, const entityId &id, const changeTick &since,
+                                   const std::unordered_set<entityId> *relevant);
+      void writeSnapshotOf(SLNet::BitStream &stream, bool persistentEntities);
+      static void padSnapshot(bool rw, SLNet::BitStream &stream, size_t start);
+      bool serializeSnapshotComps(bool rw, SLNet::BitStream &stream, size_t start, const std::vector<bool> *excluded);
+      void fireSnapshotCallbacks(const std::vector<entityId> &ids, const std::vector<Existence> &existences);
+      void restoreEntitySlots(const std::vector<entityId> &ids, const std::vector<entityId> &slots);
+      void rebuildFreeList();
+      template<typename ... compTypes>
+      void clearComps(const entityId& id, compMask present, CompTypeList<compTypes...>);
+      template<typename ... compTypes>
+      void fireTeardownCallbacks(const std::vector<std::pair<entityId, compMask>>& doomed, CompTypeList<compTypes...>);
+      template<typename ... compTypes>
+      void fireUnclearedCallbacks(const std::vector<std::pair<entityId, compMask>>& doomed,
+                                  const std::unordered_set<listenerHandle>& cleared, CompTypeList<compTypes...>);
+      template<typename ... compTypes>
+      void eraseComps(const std::vector<std::pair<entityId, compMask>>& doomed, CompTypeList<compTypes...>);
+      template<typename ... compTypes>
+      void gatherPersistent(std::vector<entityId>& kept, CompTypeList<compTypes...>);
+      template<typename ... compTypes>
+      void resetCollections(const std::vector<entityId>& kept, const compMask& keptComps, CompTypeList<compTypes...>);
+      template<typename ... compTypes>
+      void reportCollections(MemoryReport &report, CompTypeList<compTypes...>);
+      template<typename ... compTypes>
+      void shrinkCollections(CompTypeList<compTypes...>);
+#ifdef EZECS_PROFILING
+      std::array<CompProfile, AllCompTypes::size> compProfiles;
+      template<typename compType>
+      CompProfile& profileOf() { return compProfiles[CompTraits<compType>::index]; }
+      template<typename ... compTypes>
+      void publishProfiles(CompTypeList<compTypes...>);
+#endif
 
       /*
        * The rest of this stuff is used by the public component collection manipulation methods
        */
       
       template<typename compType>
-      inline CompOpReturn remCompNoChecks(KvMap<entityId, compType>& coll, Existence* existence,
-                          const entityId& id, const EntNotifyDelegates& callbacks);
+      inline CompOpReturn remCompNoChecks(CompCollection<compType>& coll, const entityId& id,
+                                          EntNotifyDelegates& callbacks);
 
       template<typename compType, typename ... types>
-      inline CompOpReturn addComp(KvMap<entityId, compType>& coll, const entityId& id,
-                           const EntNotifyDelegates& callbacks, const types& ... args);
+      inline CompOpReturn addComp(CompCollection<compType>& coll, const entityId& id,
+                           EntNotifyDelegates& callbacks, const types& ... args);
 
 		  template<typename compType>
-		  inline CompOpReturn insertComp(KvMap<entityId, compType>& coll, const entityId& id,
-		                                 const EntNotifyDelegates& callbacks, compType && input);
+		  inline CompOpReturn insertComp(CompCollection<compType>& coll, const entityId& id,
+		                                 EntNotifyDelegates& callbacks, compType && input);
 		  
+      template<typename compType, typename ... types>
+      inline CompOpReturn addCompBulk(CompCollection<compType>& coll, std::span<const entityId> ids,
+                                      EntNotifyDelegates& callbacks, const types& ... args);
+
       template<typename compType>
-      inline CompOpReturn remComp(KvMap<entityId, compType>& coll, const entityId& id,
-                                  const EntNotifyDelegates& callbacks);
+      inline CompOpReturn remComp(CompCollection<compType>& coll, const entityId& id,
+                                  EntNotifyDelegates& callbacks);
       
       template<typename compType>
-      inline CompOpReturn getComp(KvMap<entityId, compType>& coll, const entityId& id, compType** out);
+      inline CompOpReturn getComp(CompCollection<compType>& coll, const entityId& id, compType** out);
+
+      template<typename compType, bool hasData>
+      inline bool snapshotComps(bool rw, SLNet::BitStream &stream, size_t start, const uint64_t &schema,
+                                const std::vector<bool> *excluded);
+      template<typename compType>
+      inline void fireSnapshotCallbacks(const std::vector<entityId> &ids, const std::vector<Existence> &existences);
 
       inline bool shouldFireRemovalDlgt(const compMask& likeness, const compMask& current, const compMask& typeRemoved);
       inline bool shouldFireAdditionDlgt(const compMask& likeness, const compMask& current, const compMask& typeAdded);
+
+      template<typename drivingType, typename ... compTypes, typename Fn>
+      void forEachDrivenBy(Fn& fn);
+      template<typename compType, typename drivingType>
+      compType* findForEach(const entityId& id, drivingType& driving);
+#ifdef EZECS_ARCHETYPES
+      template<typename compType>
+      compType& inChunk(compType* column, const entityId& id, size_t row);
+#endif
   };
 
+  template<typename compType>
+  const CompCollection<compType>& State::getCollection() {
+    return collectionOf(static_cast<compType*>(nullptr));
+  }
+
+  template<typename compType>
+  CompCollection<compType> State::makeCollection() {
+#ifdef EZECS_ARCHETYPES
+    return CompCollection<compType>(archetypes);
+#else
+    return CompCollection<compType>();
+#endif
+  }
+
+#ifdef EZECS_PROFILING
+  template<typename compType>
+  const CompProfile& State::getProfile() {
+    return profileOf<compType>();
+  }
+#endif
+
+  template<typename compType, typename Fn>
+  void State::forEachChangedSince(const changeTick& tick, Fn&& fn) {
+    ChangeTracker &changes = changesOf(static_cast<compType*>(nullptr));
+    for (auto &&pair : collectionOf(static_cast<compType*>(nullptr))) {
+      if (changes.changedSince(pair.first, tick)) {
+        fn(pair.first, pair.second);
+      }
+    }
+  }
+
+  template<typename compType>
+  const ChangeTracker& State::getChanges() {
+    return changesOf(static_cast<compType*>(nullptr));
+  }
+
+  template<typename ... compTypes, typename Fn>
+  void State::forEach(Fn&& fn) {
+#ifdef EZECS_ARCHETYPES
+    // Each chunk holds an array per type, so the components are walked in order rather than looked up
+    archetypes.forEachChunk((compTypes::flag | ...), [this, &fn](const ArchetypeChunk &chunk) {
+      std::tuple<compTypes*...> columns{ chunk.column<compTypes>()... };
+      const entityId* ids = chunk.ids();
+      for (size_t i = 0; i < chunk.size(); ++i) {
+        fn(ids[i], inChunk<compTypes>(std::get<compTypes*>(columns), ids[i], i)...);
+      }
+    });
+#else
+    // Walk whichever of the requested collections is smallest
+    size_t sizes[] = { getCollection<compTypes>().size()... };
+    size_t smallest = 0;
+    for (size_t i = 1; i < sizeof...(compTypes); ++i) {
+      if (sizes[i] < sizes[smallest]) {
+        smallest = i;
+      }
+    }
+    size_t i = 0;
+    (void) ((i++ == smallest ? (forEachDrivenBy<compTypes, compTypes...>(fn), true) : false) || ...);
+#endif
+  }
+
+  template<typename drivingType, typename ... compTypes, typename Fn>
+  void State::forEachDrivenBy(Fn& fn) {
+    for (auto &&pair : collectionOf(static_cast<drivingType*>(nullptr))) {
+      std::tuple<compTypes*...> comps{ findForEach<compTypes>(pair.first, pair.second)... };
+      if ((std::get<compTypes*>(comps) && ...)) {
+        fn(pair.first, *std::get<compTypes*>(comps)...);
+      }
+    }
+  }
+
+#ifdef EZECS_ARCHETYPES
+  template<typename compType>
+  compType& State::inChunk(compType* column, const entityId& id, size_t row) {
+    if constexpr (std::is_same<compType, Existence>::value) {
+      return comps_Existence.at(id); // kept apart from the chunks
+    } else {
+      return column[row];
+    }
+  }
+#endif
+
+  template<typename compType, typename drivingType>
+  compType* State::findForEach(const entityId& id, drivingType& driving) {
+    if constexpr (std::is_same<compType, drivingType>::value) {
+      return &driving;
+    } else {
+      return collectionOf(static_cast<compType*>(nullptr)).find(id);
+    }
+  }
+
+  void EntNotifyGroup::fire(const entityId& id) {
+    for (auto &dlgt : delegates) {
+      dlgt.fire(id);
+    }
+  }
+
+  inline void EntNotifyDelegates::push_back(const EntNotifyDelegate& dlgt) {
+    for (auto &group : groups) {
+      if (group.likeness == dlgt.likeness) {
+        group.delegates.push_back(dlgt);
+        return;
+      }
+    }
+    groups.push_back(EntNotifyGroup{ dlgt.likeness, { dlgt } });
+  }
+  inline void EntNotifyDelegates::remove(const listenerHandle& handle) {
+    for (auto group = groups.begin(); group != groups.end(); ++group) {
+      auto found = std::find_if(group->delegates.begin(), group->delegates.end(),
+                                [&handle](const EntNotifyDelegate &dlgt) { return dlgt.handle == handle; });
+      if (found != group->delegates.end()) {
+        group->delegates.erase(found);
+        if (group->delegates.empty()) {
+          groups.erase(group);
+        }
+        return;
+      }
+    }
+  }
+  inline MemoryUsage EntNotifyDelegates::memoryUsage() const {
+    MemoryUsage usage = MemoryUsage::of(groups, true);
+    for (auto &group : groups) {
+      usage += MemoryUsage::of(group.delegates);
+    }
+    return usage;
+  }
+  inline void EntNotifyDelegates::shrinkToFit() {
+    for (auto &group : groups) {
+      group.delegates.shrink_to_fit();
+    }
+    groups.shrink_to_fit();
+  }
+
+  template<typename Fn>
+  void State::forEachLikeEntity(const compMask& likeness, Fn&& fn) {
+#ifdef EZECS_ARCHETYPES
+    archetypes.forEach(likeness, fn);
+#else
+    for (auto pair : comps_Existence) {
+      if (hasAll(pair.second.componentsPresent, likeness)) {
+        fn(pair.first);
+      }
+    }
+#endif
+  }
+
 }
@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2016 Galen Cochrane
+ * Galen Cochrane <galencochrane@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#pragma once
+
+#include "ecsState.generated.hpp"
+
+/*
+ * The templates that add, insert, remove and get components are needed both by ecsState.generated.cpp and by every
+ * ecsState.<n>.generated.cpp unit that holds the per-type methods built on them, so they are defined here.
+ */
+
+namespace ezecs {
+
+  template<typename compType>
+  inline CompOpReturn State::remCompNoChecks(CompCollection<compType>& coll, const entityId& id,
+                                             EntNotifyDelegates& callbacks)
+  {
+    compMask current = comps_Existence.at(id).componentsPresent;
+    for (auto &group : callbacks) {
+      if (shouldFireRemovalDlgt(group.likeness, current, compType::flag)) {
+        group.fire(id);
+#ifdef EZECS_PROFILING
+        profileOf<compType>().removalFires += group.delegates.size();
+#endif
+      }
+    }
+    coll.erase(id);
+    Existence &existence = comps_Existence.at(id); // looked up again, since delegates may have moved it
+    existence.turnOffFlags(compType::flag);
+#ifdef EZECS_PROFILING
+    ++profileOf<compType>().removals;
+#endif
+    return SUCCESS;
+  }
+
+  template<typename compType, typename ... types>
+  inline CompOpReturn State::addComp(CompCollection<compType>& coll, const entityId& id,
+                                     EntNotifyDelegates& callbacks, const types &... args)
+  {
+	  Existence* existence = comps_Existence.find(id);
+	  if (existence) {
+		  if (existence->passesPrerequisitesForAddition(compType::requiredComps)) {
+			  bool wasEmplaced = coll.try_emplace(id, args...);
+		  	if (wasEmplaced) {
+		  		compMask current = existence->componentsPresent;
+				  for (auto &group : callbacks) {
+					  if (shouldFireAdditionDlgt(group.likeness, current, compType::flag)) {
+						  group.fire(id);
+#ifdef EZECS_PROFILING
+						  profileOf<compType>().additionFires += group.delegates.size();
+#endif
+					  }
+				  }
+				  existence = &comps_Existence.at(id); // looked up again, since delegates may have moved it
+				  existence->turnOnFlags(compType::flag);
+				  changesOf(static_cast<compType*>(nullptr)).mark(id, currentTick);
+#ifdef EZECS_PROFILING
+				  ++profileOf<compType>().additions;
+#endif
+				  return SUCCESS;
+		  	}
+			  return REDUNDANT;
+		  }
+		  return PREREQ_FAIL;
+	  }
+	  return NONEXISTENT_ENT;
+  }
+
+  template<typename compType, typename ... types>
+  inline CompOpReturn State::addCompBulk(CompCollection<compType>& coll, std::span<const entityId> ids,
+                                         EntNotifyDelegates& callbacks, const types &... args)
+  {
+    EZECS_PROFILE_SCOPE(CompTraits<compType>::name, "bulk addition");
+    CompOpReturn result = SUCCESS;
+    std::vector<std::pair<entityId, compMask>> added; // with the components each entity had beforehand
+    added.reserve(ids.size());
+    coll.reserve(coll.size() + ids.size());
+    for (auto id : ids) {
+      Existence* existence = comps_Existence.find(id);
+      if ( ! existence) {
+        result = result == SUCCESS ? NONEXISTENT_ENT : result;
+      } else if ( ! existence->passesPrerequisitesForAddition(compType::requiredComps)) {
+        result = result == SUCCESS ? PREREQ_FAIL : result;
+      } else if ( ! coll.try_emplace(id, args...)) {
+        result = result == SUCCESS ? REDUNDANT : result;
+      } else {
+        added.emplace_back(id, existence->componentsPresent);
+        existence->turnOnFlags(compType::flag);
+        changesOf(static_cast<compType*>(nullptr)).mark(id, currentTick);
+      }
+    }
+    // Delegates are fired after every component is in place, one group of delegates at a time.
+    for (auto &group : callbacks) {
+      for (auto &entity : added) {
+        if (shouldFireAdditionDlgt(group.likeness, entity.second, compType::flag)) {
+          group.fire(entity.first);
+#ifdef EZECS_PROFILING
+          profileOf<compType>().additionFires += group.delegates.size();
+#endif
+        }
+      }
+    }
+#ifdef EZECS_PROFILING
+    profileOf<compType>().additions += added.size();
+#endif
+    return result;
+  }
+
+	template<typename compType>
+	inline CompOpReturn State::insertComp(CompCollection<compType>& coll, const entityId& id,
+	                                      EntNotifyDelegates& callbacks, compType && input)
+	{
+		Existence* existence = comps_Existence.find(id);
+		if (existence) {
+			if (existence->passesPrerequisitesForAddition(compType::requiredComps)) {
+				bool wasInserted = coll.insert(id, std::forward<compType>(input));
+				if (wasInserted) {
+					compMask current = existence->componentsPresent;
+					for (auto &group : callbacks) {
+						if (shouldFireAdditionDlgt(group.likeness, current, compType::flag)) {
+							group.fire(id);
+#ifdef EZECS_PROFILING
+							profileOf<compType>().additionFires += group.delegates.size();
+#endif
+						}
+					}
+					existence = &comps_Existence.at(id); // looked up again, since delegates may have moved it
+					existence->turnOnFlags(compType::flag);
+					changesOf(static_cast<compType*>(nullptr)).mark(id, currentTick);
+#ifdef EZECS_PROFILING
+					++profileOf<compType>().additions;
+#endif
+					return SUCCESS;
+				}
+				return REDUNDANT;
+			}
+			return PREREQ_FAIL;
+		}
+		return NONEXISTENT_ENT;
+	}
+
+  template<typename compType>
+  inline CompOpReturn State::remComp(CompCollection<compType>& coll, const entityId& id,
+                                     EntNotifyDelegates& callbacks)
+  {
+    Existence* existence = comps_Existence.find(id);
+    if (existence) {
+      if (coll.count(id)) {
+        if (existence->passesDependenciesForRemoval(compType::dependentComps)) {
+          return remCompNoChecks(coll, id, callbacks);
+        }
+        return DEPEND_FAIL;
+      }
+      return NONEXISTENT_COMP;
+    }
+    return NONEXISTENT_ENT;
+  }
+
+  template<typename compType>
+  inline CompOpReturn State::getComp(CompCollection<compType> &coll, const entityId& id, compType** out) {
+    *out = coll.find(id); // a null pointer will hopefully catch some bugs if somebody uses this wrong.
+    return *out ? SUCCESS : NONEXISTENT_COMP;
+  }
+
+  inline bool State::shouldFireRemovalDlgt(const compMask& likeness, const compMask& current,
+                                           const compMask& typeRemoved)
+  {
+    if (hasAll(current, likeness)) {
+      if ( (likeness & ~typeRemoved) != likeness) {
+        return true;
+      }
+    }
+    return false;
+  }
+  inline bool State::shouldFireAdditionDlgt(const compMask& likeness, const compMask& current,
+                                            const compMask& typeAdded)
+  {
+    if ( ! hasAll(current, likeness)) {
+      if (hasAll(current | typeAdded, likeness)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+}
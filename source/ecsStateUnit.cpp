@@ -0,0 +1,41 @@
+/*
+ * Copyright (c) 2016 Galen Cochrane
+ * Galen Cochrane <galencochrane@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "ecsStateTemplates.hpp"
+#include "ecsHelpers.hpp"
+
+#pragma clang diagnostic ignored "-Wundefined-var-template"
+
+using namespace rtu::topics;
+using namespace SLNet;
+
+/*
+ * Each ecsState.<n>.generated.cpp is made from this file, and holds the collection manipulation methods of the
+ * component types that the generator hashed into unit n. Keeping them apart from ecsState.generated.cpp means that
+ * a change to one type only recompiles the unit that type is in (as long as ecsState.generated.hpp is unchanged).
+ */
+
+namespace ezecs {
+
+  // COMPONENT COLLECTION MANIPULATION METHOD DEFINITIONS APPEAR HERE
+
+}
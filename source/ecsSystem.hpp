@@ -27,36 +27,167 @@
 #include <vector>
 #include <algorithm>
 #include "ecsState.generated.hpp"
+#include "ecsThreadPool.hpp"
 
 namespace ezecs {
 
   typedef rtu::Delegate<bool(const entityId& id)> entNotifyHandler;
   static bool passThrough(const entityId &) { return true; }
 
+  /*
+   * How parallelForEach splits up its work. ANY_ORDER picks chunk sizes based on the number of threads, so the way
+   * entities are grouped together can differ from one machine to the next. DETERMINISTIC_ORDER always uses chunks of
+   * IdRegistry::chunkCapacity IDs, so per-chunk results combined in chunk order are reproducible everywhere.
+   */
+  enum ParallelOrder {
+    ANY_ORDER, DETERMINISTIC_ORDER
+  };
+
   struct IdRegistry {
+    /*
+     * The number of IDs that fit in 16 KB, which keeps a chunk of IDs well within a core's L1 cache
+     */
+    static constexpr size_t chunkCapacity = 16384 / sizeof(entityId);
+
     std::vector<entityId> ids;
+    KvMap<entityId, size_t> slots; // the position of each ID within ids
     entNotifyHandler discoverHandler;
     entNotifyHandler forgetHandler;
     explicit IdRegistry(entNotifyHandler&& discoverHandler = RTU_FUNC_DLGT(passThrough),
                         entNotifyHandler&& forgetHandler   = RTU_FUNC_DLGT(passThrough))
                         : discoverHandler(discoverHandler), forgetHandler(forgetHandler) { }
+
+    bool contains(const entityId& id) const;
+    void add(const entityId& id);
+
+    /*
+     * Removes an ID in constant time by moving the last ID into its place, so the order of ids is not stable.
+     */
+    void remove(const entityId& id);
+
+    /*
+     * Removes every ID at once, without calling forgetHandler.
+     */
+    void forgetAll();
+
+    MemoryUsage memoryUsage() const;
+    void shrinkToFit();
+
+    /*
+     * Calls fn(const entityId& id) for every ID in the registry, spread across the threads of the pool. fn may be
+     * called from several threads at once, so it must only touch data belonging to the entity it is given (or
+     * otherwise synchronize). Entities must not be created or deleted, nor components added or removed, until this
+     * returns.
+     */
+    template<typename Fn>
+    void parallelForEach(Fn &&fn, ParallelOrder order = ANY_ORDER, ThreadPool &pool = ThreadPool::shared()) const;
+
+    /*
+     * Like parallelForEach, but calls fn(const entityId* ids, size_t count, size_t chunkIndex) once per chunk of IDs.
+     */
+    template<typename Fn>
+    void parallelForEachChunk(Fn &&fn, ParallelOrder order = ANY_ORDER, ThreadPool &pool = ThreadPool::shared()) const;
   };
 	static void discover(const entityId& id, void* data) {
 		auto registry = reinterpret_cast<IdRegistry*>(data);
 		if (registry->discoverHandler(id)) {
-			registry->ids.push_back(id);
+			registry->add(id);
 		}
 	}
 	static void forget(const entityId& id, void* data) {
 		auto registry = reinterpret_cast<IdRegistry*>(data);
-		auto position = std::find(registry->ids.begin(), registry->ids.end(), id);
-		if (position != registry->ids.end()) {
+		if (registry->contains(id)) {
 			if (registry->forgetHandler(id)) {
-				registry->ids.erase(position);
+				registry->remove(id);
+			}
+		}
+	}
+	/*
+	 * Called by State::clear once it has deleted every entity but the persistent ones, so that the registry can be
+	 * emptied in one go rather than one removal at a time.
+	 */
+	static void forgetEverything(const State& state, void* data) {
+		auto registry = reinterpret_cast<IdRegistry*>(data);
+		std::vector<entityId> kept;
+		for (auto id : registry->ids) {
+			if (state.isAlive(id) || ! registry->forgetHandler(id)) {
+				kept.push_back(id);
 			}
 		}
+		registry->forgetAll();
+		for (auto id : kept) {
+			registry->add(id);
+		}
 	}
 
+  inline bool IdRegistry::contains(const entityId& id) const {
+    return slots.contains(id);
+  }
+  inline void IdRegistry::add(const entityId& id) {
+    if (slots.try_emplace(id, ids.size())) {
+      ids.push_back(id);
+    }
+  }
+  inline void IdRegistry::remove(const entityId& id) {
+    size_t* slot = slots.find(id);
+    if ( ! slot) {
+      return;
+    }
+    size_t position = *slot;
+    if (position != ids.size() - 1) {
+      ids[position] = ids.back();
+      slots.at(ids[position]) = position;
+    }
+    ids.pop_back();
+    slots.erase(id);
+  }
+  inline void IdRegistry::forgetAll() {
+    ids.clear();
+    slots.clear();
+  }
+  inline MemoryUsage IdRegistry::memoryUsage() const {
+    MemoryUsage usage = MemoryUsage::of(ids);
+    MemoryUsage slotUsage = slots.memoryUsage();
+    usage.overhead += slotUsage.payload + slotUsage.overhead;
+    usage.slack += slotUsage.slack;
+    return usage;
+  }
+  inline void IdRegistry::shrinkToFit() {
+    ids.shrink_to_fit();
+    slots.shrinkToFit();
+  }
+
+  template<typename Fn>
+  void IdRegistry::parallelForEach(Fn &&fn, ParallelOrder order, ThreadPool &pool) const {
+    parallelForEachChunk([&fn](const entityId* chunk, size_t count, size_t) {
+      for (size_t i = 0; i < count; ++i) {
+        fn(chunk[i]);
+      }
+    }, order, pool);
+  }
+  template<typename Fn>
+  void IdRegistry::parallelForEachChunk(Fn &&fn, ParallelOrder order, ThreadPool &pool) const {
+    size_t chunkSize = chunkCapacity;
+    if (order == ANY_ORDER) {
+      // Aim for a few chunks per thread so that stealing can even out the load, without going below a useful size.
+      size_t perThread = ids.size() / ((pool.numThreads() + 1) * 4) + 1;
+      chunkSize = std::max(perThread, chunkCapacity / 16);
+    }
+    const entityId* data = ids.data();
+    parallelFor(ids.size(), chunkSize, [&fn, data](size_t begin, size_t end, size_t chunk) {
+      fn(data + begin, end - begin, chunk);
+    }, pool);
+  }
+
+  /*
+   * Which component types a system reads and which it writes during its tick. The Scheduler uses these to decide which
+   * systems can tick at the same time, so a system that does not declare them is assumed to read and write everything.
+   */
+  struct SystemAccess {
+    compMask reads = ALL;
+    compMask writes = ALL;
+  };
+
   template<typename Derived_System>
   class System
   {
@@ -68,31 +199,61 @@ namespace ezecs {
       std::string name = "Generic System";
       State* state;
       std::vector<IdRegistry> registries;
+      std::vector<listenerHandle> listeners;
+      SystemAccess access;
 
     public:
-      explicit System(State* state, std::vector<ezecs::compMask> &&requiredComps);
+      explicit System(State* state, std::vector<ezecs::compMask> &&requiredComps,
+                      SystemAccess access = SystemAccess());
       virtual ~System();
+      const SystemAccess &getAccess() const;
       void tick(double dt);
+
+      /*
+       * Runs fn(const entityId& id) for every entity in one of this system's registries across the threads of the pool.
+       * See IdRegistry::parallelForEach.
+       */
+      template<typename Fn>
+      void parallelForEach(size_t registry, Fn &&fn, ParallelOrder order = ANY_ORDER,
+                           ThreadPool &pool = ThreadPool::shared());
       void pause();
       void resume();
       void clean();
       bool isPaused();
+
+      /*
+       * Adds the memory used by each of this system's registries to a report made by State::memoryReport
+       */
+      void reportMemory(MemoryReport &report) const;
+
+      /*
+       * Gives back the memory that the registries hold without using (see State::shrinkToFit)
+       */
+      void shrinkToFit();
   };
 
   template<typename Derived_System>
-  System<Derived_System>::System(State* state, std::vector<ezecs::compMask> &&requiredComps) : state(state) {
+  System<Derived_System>::System(State* state, std::vector<ezecs::compMask> &&requiredComps, SystemAccess access)
+      : state(state), access(access) {
 	  registries.resize(requiredComps.size());
 	  for (size_t i = 0; i < requiredComps.size(); ++i) {
-		  state->listenForLikeEntities(
+		  listeners.push_back(state->listenForLikeEntities(
 					  requiredComps[i],
 					  EntNotifyDelegate{ RTU_FUNC_DLGT(discover), requiredComps[i], &registries[i] },
-					  EntNotifyDelegate{ RTU_FUNC_DLGT(forget), requiredComps[i], &registries[i] }
-		  );
+					  EntNotifyDelegate{ RTU_FUNC_DLGT(forget), requiredComps[i], &registries[i] },
+					  ClearNotifyDelegate{ RTU_FUNC_DLGT(forgetEverything), &registries[i] }
+		  ));
 	  }
   }
   template<typename Derived_System>
   System<Derived_System>::~System() {
-    // TODO: Remove callbacks from State
+    for (auto handle : listeners) {
+      state->stopListening(handle);
+    }
+  }
+  template<typename Derived_System>
+  const SystemAccess &System<Derived_System>::getAccess() const {
+    return access;
   }
   template<typename Derived_System>
   Derived_System& System<Derived_System>::sys() {
@@ -100,9 +261,15 @@ namespace ezecs {
   }
   template<typename Derived_System>
   void System<Derived_System>::tick(double dt) {
+    EZECS_PROFILE_SCOPE(name.c_str(), "system");
     sys().onTick(dt);
   }
   template<typename Derived_System>
+  template<typename Fn>
+  void System<Derived_System>::parallelForEach(size_t registry, Fn &&fn, ParallelOrder order, ThreadPool &pool) {
+    registries[registry].parallelForEach(std::forward<Fn>(fn), order, pool);
+  }
+  template<typename Derived_System>
   void System<Derived_System>::pause(){
     if (!paused){
       paused = true;
@@ -117,12 +284,24 @@ namespace ezecs {
   template<typename Derived_System>
   void System<Derived_System>::clean(){
     sys().onClean();
-    for (auto registry : registries) {
-      registry.ids.clear();
+    for (auto &registry : registries) {
+      registry.forgetAll();
     }
   }
   template<typename Derived_System>
   bool System<Derived_System>::isPaused(){
     return paused;
   }
+  template<typename Derived_System>
+  void System<Derived_System>::reportMemory(MemoryReport &report) const {
+    for (size_t i = 0; i < registries.size(); ++i) {
+      report.registries.push_back({ name, i, registries[i].ids.size(), registries[i].memoryUsage() });
+    }
+  }
+  template<typename Derived_System>
+  void System<Derived_System>::shrinkToFit() {
+    for (auto &registry : registries) {
+      registry.shrinkToFit();
+    }
+  }
 }
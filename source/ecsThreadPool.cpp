@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2016 Galen Cochrane
+ * Galen Cochrane <galencochrane@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+#include "ecsThreadPool.hpp"
+
+namespace ezecs {
+
+  // The pool and index of the queue owned by the current thread, if the current thread is a worker
+  static thread_local const ThreadPool *ownPool = nullptr;
+  static thread_local size_t ownQueue = 0;
+
+  ThreadPool::ThreadPool(size_t numThreads) {
+    if ( ! numThreads) {
+      unsigned hardwareThreads = std::thread::hardware_concurrency();
+      numThreads = hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+    }
+    queues.resize(numThreads ? numThreads : 1); // with no workers, waiting threads still need a queue to run from
+    for (auto &queue : queues) {
+      queue = std::make_unique<Queue>();
+    }
+    for (size_t i = 0; i < numThreads; ++i) {
+      workers.emplace_back(&ThreadPool::work, this, i);
+    }
+  }
+
+  ThreadPool::~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex);
+      stopping = true;
+    }
+    wake.notify_all();
+    for (auto &worker : workers) {
+      worker.join();
+    }
+  }
+
+  void ThreadPool::submit(Task &&task) {
+    size_t queue = ownPool == this ? ownQueue : nextQueue++ % queues.size();
+    {
+      std::lock_guard<std::mutex> lock(queues[queue]->mutex);
+      queues[queue]->tasks.push_back(std::move(task));
+    }
+    {
+      std::lock_guard<std::mutex> lock(sleepMutex);
+      ++numPending;
+    }
+    wake.notify_one();
+  }
+
+  bool ThreadPool::runPendingTask() {
+    Task task;
+    bool isWorker = ownPool == this;
+    if ((isWorker && popOwn(ownQueue, task)) || steal(isWorker ? ownQueue + 1 : 0, task)) {
+      --numPending;
+      task();
+      return true;
+    }
+    return false;
+  }
+
+  size_t ThreadPool::numThreads() const {
+    return workers.size();
+  }
+
+  ThreadPool &ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+  }
+
+  bool ThreadPool::popOwn(size_t queue, Task &task) {
+    std::lock_guard<std::mutex> lock(queues[queue]->mutex);
+    if (queues[queue]->tasks.empty()) {
+      return false;
+    }
+    task = std::move(queues[queue]->tasks.back());
+    queues[queue]->tasks.pop_back();
+    return true;
+  }
+
+  bool ThreadPool::steal(size_t start, Task &task) {
+    for (size_t i = 0; i < queues.size(); ++i) {
+      Queue &victim = *queues[(start + i) % queues.size()];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if ( ! victim.tasks.empty()) {
+        task = std::move(victim.tasks.front());
+        victim.tasks.pop_front();
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void ThreadPool::work(size_t queue) {
+    ownPool = this;
+    ownQueue = queue;
+    while ( ! stopping) {
+      if ( ! runPendingTask()) {
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wake.wait(lock, [this] { return stopping || numPending > 0; });
+      }
+    }
+  }
+
+  TaskGroup::TaskGroup(ThreadPool &pool) : pool(pool), progress(std::make_shared<Progress>()) { }
+
+  TaskGroup::~TaskGroup() {
+    try {
+      wait();
+    } catch (...) { } // a destructor must not throw, and the tasks are done either way
+  }
+
+  void TaskGroup::run(ThreadPool::Task &&task) {
+    ++progress->numRunning;
+    pool.submit([progress = progress, task = std::move(task)] {
+      // The task is counted as finished however it ends, so that waiting threads are never left hanging.
+      struct Finish {
+        Progress &progress;
+        ~Finish() {
+          if ( ! --progress.numRunning) {
+            std::lock_guard<std::mutex> lock(progress.mutex);
+            progress.finished.notify_all();
+          }
+        }
+      } finish { *progress };
+      try {
+        task();
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(progress->mutex);
+        if ( ! progress->error) {
+          progress->error = std::current_exception();
+        }
+      }
+    });
+    {
+      std::lock_guard<std::mutex> lock(progress->mutex);
+      ++progress->numAdded;
+    }
+    progress->finished.notify_all();
+  }
+
+  void TaskGroup::wait() {
+    while (progress->numRunning) {
+      if ( ! pool.runPendingTask()) {
+        // Nothing is left to take, so the group's remaining tasks are all running on other threads.
+        std::unique_lock<std::mutex> lock(progress->mutex);
+        size_t numAdded = progress->numAdded;
+        progress->finished.wait(lock, [this, numAdded] {
+          return ! progress->numRunning || progress->numAdded != numAdded;
+        });
+      }
+    }
+    std::exception_ptr error;
+    {
+      std::lock_guard<std::mutex> lock(progress->mutex);
+      std::swap(error, progress->error);
+    }
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
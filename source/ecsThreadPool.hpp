@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2016 Galen Cochrane
+ * Galen Cochrane <galencochrane@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * A work-stealing thread pool. Every worker has its own queue of tasks. A worker takes tasks from the back of its own
+ * queue (the most recently pushed, whose data is most likely still in cache) and, when its queue is empty, steals from
+ * the front of the other workers' queues. Tasks submitted from outside of the pool are spread across the queues.
+ *
+ * A thread waiting on a TaskGroup runs pending tasks itself until there are none left to take, so tasks may safely
+ * submit and wait on more tasks, and the waiting thread (usually the main thread) contributes to the work. Only then
+ * does it sleep until the group's last task finishes.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ezecs {
+
+  class ThreadPool {
+    public:
+      typedef std::function<void()> Task;
+
+      /*
+       * numThreads is the number of worker threads, not counting whichever threads wait on tasks (see TaskGroup).
+       * Zero picks one less than the number of hardware threads.
+       */
+      explicit ThreadPool(size_t numThreads = 0);
+      ~ThreadPool();
+      ThreadPool(const ThreadPool &) = delete;
+      ThreadPool &operator = (const ThreadPool &) = delete;
+
+      void submit(Task &&task);
+      bool runPendingTask();
+      size_t numThreads() const;
+
+      /*
+       * A pool shared by everything in the process that does not need its own
+       */
+      static ThreadPool &shared();
+
+    private:
+      struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+      };
+      std::vector<std::unique_ptr<Queue>> queues;
+      std::vector<std::thread> workers;
+      std::mutex sleepMutex;
+      std::condition_variable wake;
+      std::atomic<std::ptrdiff_t> numPending { 0 }; // signed, since a task can be taken before it is counted
+      std::atomic<size_t> nextQueue { 0 };
+      std::atomic<bool> stopping { false };
+
+      bool popOwn(size_t queue, Task &task);
+      bool steal(size_t start, Task &task);
+      void work(size_t queue);
+  };
+
+  /*
+   * Tracks a set of tasks so that they can all be waited on together.
+   * EXAMPLE: TaskGroup group(pool); group.run([]{ ... }); group.run([]{ ... }); group.wait();
+   * If any of the tasks throws, the rest still run, and wait rethrows the first exception once they are all done. The
+   * destructor waits too, but drops any exception that nobody waited for.
+   */
+  class TaskGroup {
+    public:
+      explicit TaskGroup(ThreadPool &pool = ThreadPool::shared());
+      ~TaskGroup();
+      void run(ThreadPool::Task &&task);
+      void wait();
+
+    private:
+      struct Progress {
+        std::atomic<size_t> numRunning { 0 };
+        std::mutex mutex;
+        std::condition_variable finished; // also notified when a task is added, so that sleeping waiters can help
+        size_t numAdded = 0;
+        std::exception_ptr error; // the first exception thrown by a task
+      };
+      ThreadPool &pool;
+      std::shared_ptr<Progress> progress;
+  };
+
+  /*
+   * Splits the range [0, count) into chunks of chunkSize (the last one may be smaller) and calls
+   * fn(size_t begin, size_t end, size_t chunkIndex) once per chunk on the pool, returning when every chunk is done.
+   * Chunk boundaries depend only on count and chunkSize, never on the number of threads, so a result that is
+   * accumulated per chunk and then combined in chunkIndex order comes out the same on every machine.
+   */
+  template<typename Fn>
+  void parallelFor(size_t count, size_t chunkSize, Fn &&fn, ThreadPool &pool = ThreadPool::shared());
+
+  template<typename Fn>
+  void parallelFor(size_t count, size_t chunkSize, Fn &&fn, ThreadPool &pool) {
+    if ( ! chunkSize) {
+      chunkSize = 1;
+    }
+    if (count <= chunkSize || ! pool.numThreads()) {
+      for (size_t begin = 0, chunk = 0; begin < count; begin += chunkSize, ++chunk) {
+        fn(begin, std::min(begin + chunkSize, count), chunk);
+      }
+      return;
+    }
+    TaskGroup group(pool);
+    for (size_t begin = chunkSize, chunk = 1; begin < count; begin += chunkSize, ++chunk) {
+      group.run([&fn, begin, chunk, chunkSize, count] { fn(begin, std::min(begin + chunkSize, count), chunk); });
+    }
+    fn(0, chunkSize, 0); // the calling thread takes the first chunk itself
+    group.wait();
+  }
+}
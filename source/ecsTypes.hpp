@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include "ecsMask.hpp"
 
 namespace ezecs {
 
@@ -9,9 +11,55 @@ namespace ezecs {
  * represent a set of component types. Each bit corresponds to 
  * a single component type. "entityId" is the type used for 
  * entity IDs (surprise!).
+ * A compMask is a plain 32-bit integer, unless EZECS_MASK_BITS 
+ * asks for 128 or 256 bits (see the CMake option of the same 
+ * name), in which case it is a WideMask (see ecsMask.hpp).
  */
+#if defined(EZECS_MASK_BITS) && EZECS_MASK_BITS > 32
+	static_assert(EZECS_MASK_BITS == 128 || EZECS_MASK_BITS == 256, "EZECS_MASK_BITS must be 32, 128 or 256");
+	typedef WideMask<EZECS_MASK_BITS / 64> compMask;
+#else
 	typedef uint32_t compMask;
+#endif
+#ifdef EZECS_64BIT_IDS
+	typedef uint64_t entityId;
+	constexpr unsigned entityIndexBits = 32;
+#else
 	typedef uint32_t entityId;
+	constexpr unsigned entityIndexBits = 24;
+#endif
+
+/*
+ * An entity ID is a handle made of two parts: the low 'entityIndexBits' bits are the index of the slot that the entity
+ * occupies, and the remaining high bits are the generation of that slot, which is bumped every time an entity in that
+ * slot is deleted. A slot is re-used by later entities, but an old ID for it will no longer match, so holding on to the
+ * ID of a deleted entity can never accidentally refer to a new one (until the generation wraps around).
+ * Index 0 is never used, so an ID of 0 is never valid. That leaves room for entityIndexMask live entities at once, and
+ * creating more fails with MAX_ID_REACHED instead of wrapping the index.
+ */
+	constexpr entityId entityIndexMask = (entityId(1) << entityIndexBits) - 1;
+	constexpr entityId entityGenerationMask = ~entityId(0) >> entityIndexBits;
+	constexpr entityId entityIndex(const entityId &id) { return id & entityIndexMask; }
+	constexpr entityId entityGeneration(const entityId &id) { return id >> entityIndexBits; }
+	constexpr entityId makeEntityId(const entityId &index, const entityId &generation) {
+		return ((generation & entityGenerationMask) << entityIndexBits) | (index & entityIndexMask);
+	}
+
+/*
+ * Component type traits and type lists
+ * The generator specializes CompTraits for every component type (in 
+ * ecsComponents.generated.hpp), giving its name, flag, prerequisite and 
+ * dependent masks, bit index, size, alignment and attributes as 
+ * constants, and lists every type in order as AllCompTypes, a 
+ * CompTypeList. TeardownOrder lists every type but Existence with 
+ * dependents before prerequisites.
+ */
+	template<typename compType>
+	struct CompTraits;
+	template<typename ... compTypes>
+	struct CompTypeList {
+		static constexpr size_t size = sizeof...(compTypes);
+	};
 
 /*
  * Component base class
@@ -20,11 +68,13 @@ namespace ezecs {
  * member will exist for each inheritor of this class. All components 
  * must inherit from Component (this will be up to the user, who provides 
  * the configuration file).
+ * The members are taken from the type's CompTraits when first used 
+ * (after the traits are defined), so they are constant expressions.
  */
 	template<typename Derived>
 	struct Component {
-		static compMask requiredComps;
-		static compMask dependentComps;
-		static compMask flag;
+		static constexpr compMask requiredComps = CompTraits<Derived>::requiredComps;
+		static constexpr compMask dependentComps = CompTraits<Derived>::dependentComps;
+		static constexpr compMask flag = CompTraits<Derived>::flag;
 	};
 }
\ No newline at end of file
@@ -29,3 +29,6 @@
 #include "ecsKvMap.hpp"
 #include "ecsState.generated.hpp"
 #include "ecsSystem.hpp"
+#include "ecsScheduler.hpp"
+#include "ecsCommandBuffer.hpp"
+#include "ecsRelevancy.hpp"
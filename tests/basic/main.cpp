@@ -52,12 +52,10 @@ struct TestSystem : public System<TestSystem> {
   }
   void onTick(double dt) {
     outputLog << "TEST SYSTEM TICK TIME (ms): " << dt << "; bars say: ";
-    for (auto id : registries[0].ids) {
-      Bar_Comp* bar;
-      state->getBar_Comp(id, &bar);
-      bar->number += 0.2f;
-      outputLog << bar->number << ", ";
-    }
+    state->forEach<FooComp, Bar_Comp>([&](const entityId &, FooComp &, Bar_Comp &bar) {
+      bar.number += 0.2f;
+      outputLog << bar.number << ", ";
+    });
     outputLog << std::endl;
   }
   void deInit() {
@@ -0,0 +1,319 @@
+/*
+ * Copyright (c) 2016 Galen Cochrane
+ * Galen Cochrane <galencochrane@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal in the Software without restriction, including without limitation the
+ * rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+ * sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+/*
+ * Times the core operations of a State over the component types of the generated benchmark config (see
+ * CMakeLists.txt in this directory), at 1k, 10k, 100k and 1M entities.
+ *
+ * usage: ezecs_bench [--json] [--max-entities=N]
+ *
+ * Results are written to stdout, one row per benchmark and entity count, as CSV with the header
+ * "benchmark,entities,ops,total_ms,ns_per_op", or as a JSON document with --json. Anything else goes to stderr.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <memory>
+#include "ezecs.hpp"
+#include "benchTypes.hpp"
+
+#ifndef EZECS_MASK_BITS
+#define EZECS_MASK_BITS 32
+#endif
+
+using namespace ezecs;
+
+namespace {
+
+  struct BenchResult {
+    std::string name;
+    size_t entities;
+    size_t ops;
+    double totalMs;
+  };
+
+  std::vector<BenchResult> results;
+  size_t failures = 0;
+  uint64_t checksum = 0; // keeps what the benchmarks read from being optimized away
+
+  void check(CompOpReturn status) {
+    if (status != SUCCESS) {
+      ++failures;
+    }
+  }
+
+  /*
+   * Runs fn once and records how long it took to do the given number of operations.
+   */
+  template<typename Fn>
+  void measure(const std::string &name, size_t entities, size_t ops, Fn &&fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto end = std::chrono::steady_clock::now();
+    results.push_back({ name, entities, ops, std::chrono::duration<double, std::milli>(end - start).count() });
+  }
+
+  /*
+   * How many times to repeat a cheap pass over the entities, so that small counts are still timed over ~1M operations.
+   */
+  size_t repeatsFor(size_t entities) {
+    return entities < 1000000 ? 1000000 / entities : 1;
+  }
+
+  /*
+   * Operations on every entity in a list, for one component type. The benchmarks loop over these at runtime rather
+   * than being expanded once per type.
+   */
+  struct CompOps {
+    const char* name;
+    compMask flag;
+    compMask requiredComps;
+    void (*addAll)(State &state, const std::vector<entityId> &ids);
+    void (*getAll)(State &state, const std::vector<entityId> &ids);
+    void (*remAll)(State &state, const std::vector<entityId> &ids);
+  };
+
+#define EZECS_BENCH_COMP_OPS(type, typeFlag) \
+  { #type, typeFlag, CompTraits<type>::requiredComps, \
+    [](State &state, const std::vector<entityId> &ids) { \
+      for (size_t i = 0; i < ids.size(); ++i) { check(state.add##type(ids[i], (uint32_t) i)); } \
+    }, \
+    [](State &state, const std::vector<entityId> &ids) { \
+      type* comp; \
+      for (auto &id : ids) { check(state.get##type(id, &comp)); checksum += comp->payload[0]; } \
+    }, \
+    [](State &state, const std::vector<entityId> &ids) { \
+      for (auto &id : ids) { check(state.rem##type(id)); } \
+    } },
+
+  const CompOps compOps[] = { EZECS_BENCH_TYPES(EZECS_BENCH_COMP_OPS) };
+  constexpr size_t numCompTypes = sizeof(compOps) / sizeof(compOps[0]);
+
+  /*
+   * The types at the start of the config that form its first dependency chain (each depending on the one before).
+   */
+  size_t firstChainLength() {
+    size_t length = 1;
+    while (length < numCompTypes && compOps[length].requiredComps != EXISTENCE) {
+      ++length;
+    }
+    return length;
+  }
+
+  /*
+   * A system that keeps a registry per likeness it is given, and reads Bench0 from the entities in its first
+   * registry when it ticks.
+   */
+  class BenchSystem : public System<BenchSystem> {
+    public:
+      BenchSystem(State* state, std::vector<compMask> &&likenesses) : System(state, std::move(likenesses)) { }
+      void onTick(double) {
+        for (auto &id : registries[0].ids) {
+          Bench0* comp;
+          check(state->getBench0(id, &comp));
+          checksum += comp->payload[0];
+        }
+      }
+      void onClean() { }
+  };
+
+  std::vector<entityId> createEntities(State &state, size_t count) {
+    std::vector<entityId> ids(count);
+    for (auto &id : ids) {
+      check(state.createEntity(&id));
+    }
+    return ids;
+  }
+
+  void addFirstChain(State &state, const std::vector<entityId> &ids) {
+    for (size_t t = 0; t < firstChainLength(); ++t) {
+      compOps[t].addAll(state, ids);
+    }
+  }
+
+  /*
+   * createEntity, then per component type add, get and rem, then deleteEntity. To keep memory in check at large
+   * counts, each dependency chain of types is removed again before the next is added.
+   */
+  void benchEntitiesAndComps(size_t count) {
+    State state;
+    std::vector<entityId> ids;
+    measure("create_entity", count, count, [&]() { ids = createEntities(state, count); });
+    size_t chainStart = 0;
+    auto removeChain = [&](size_t chainEnd) {
+      for (size_t t = chainEnd; t-- > chainStart; ) {
+        measure(std::string("rem/") + compOps[t].name, count, count, [&]() { compOps[t].remAll(state, ids); });
+      }
+      chainStart = chainEnd;
+    };
+    for (size_t t = 0; t < numCompTypes; ++t) {
+      if (t > chainStart && compOps[t].requiredComps == EXISTENCE) {
+        removeChain(t);
+      }
+      measure(std::string("add/") + compOps[t].name, count, count, [&]() { compOps[t].addAll(state, ids); });
+      size_t repeats = repeatsFor(count);
+      measure(std::string("get/") + compOps[t].name, count, count * repeats, [&]() {
+        for (size_t r = 0; r < repeats; ++r) {
+          compOps[t].getAll(state, ids);
+        }
+      });
+    }
+    removeChain(numCompTypes);
+    measure("delete_entity", count, count, [&]() {
+      for (auto &id : ids) {
+        check(state.deleteEntity(id));
+      }
+    });
+  }
+
+  /*
+   * Adding and removing the first chain of types with systems listening for several different likenesses among them,
+   * so that every add and rem has callbacks to find and fire.
+   */
+  void benchListenerDispatch(size_t count) {
+    State state;
+    std::vector<std::unique_ptr<BenchSystem>> systems;
+    size_t chainLength = firstChainLength();
+    for (size_t s = 0; s < 16; ++s) {
+      compMask likeness = NONE;
+      for (size_t t = 0; t <= s % chainLength; ++t) {
+        likeness |= compOps[t].flag;
+      }
+      systems.emplace_back(new BenchSystem(&state, { likeness }));
+    }
+    std::vector<entityId> ids = createEntities(state, count);
+    measure("listener_dispatch_add", count, count * chainLength, [&]() { addFirstChain(state, ids); });
+    measure("listener_dispatch_rem", count, count * chainLength, [&]() {
+      for (size_t t = chainLength; t-- > 0; ) {
+        compOps[t].remAll(state, ids);
+      }
+    });
+  }
+
+  void benchClear(size_t count) {
+    State state;
+    BenchSystem system(&state, { compOps[0].flag });
+    std::vector<entityId> ids = createEntities(state, count);
+    addFirstChain(state, ids);
+    measure("clear", count, count, [&]() { state.clear(); });
+  }
+
+  /*
+   * A system ticking over its registry, and State::forEach over the first two types.
+   */
+  void benchIteration(size_t count) {
+    State state;
+    BenchSystem system(&state, { compOps[0].flag });
+    std::vector<entityId> ids = createEntities(state, count);
+    addFirstChain(state, ids);
+    size_t repeats = repeatsFor(count);
+    measure("system_tick", count, count * repeats, [&]() {
+      for (size_t r = 0; r < repeats; ++r) {
+        system.tick(0.0);
+      }
+    });
+    measure("for_each_2", count, count * repeats, [&]() {
+      for (size_t r = 0; r < repeats; ++r) {
+        state.forEach<Bench0, Bench1>([](const entityId &, Bench0 &first, Bench1 &second) {
+          checksum += first.payload[0] + second.payload[0];
+        });
+      }
+    });
+  }
+
+  /*
+   * Writes a creation request for each entity (with the first chain of types) and reads it into a second State.
+   */
+  void benchSerialization(size_t count) {
+    State source, sink;
+    std::vector<entityId> ids = createEntities(source, count);
+    addFirstChain(source, ids);
+    SLNet::BitStream stream;
+    measure("serialize_round_trip", count, count, [&]() {
+      for (auto &id : ids) {
+        stream.Reset();
+        source.serializeEntityCreationRequest(true, stream, id);
+        checksum += sink.serializeEntityCreationRequest(false, stream);
+      }
+    });
+  }
+
+  void printCsv() {
+    printf("benchmark,entities,ops,total_ms,ns_per_op\n");
+    for (auto &result : results) {
+      printf("%s,%zu,%zu,%.3f,%.2f\n", result.name.c_str(), result.entities, result.ops, result.totalMs,
+             result.totalMs * 1e6 / (double) result.ops);
+    }
+  }
+
+  void printJson() {
+    printf("{\n  \"component_types\": %zu,\n  \"mask_bits\": %d,\n  \"results\": [\n", numCompTypes, EZECS_MASK_BITS);
+    for (size_t i = 0; i < results.size(); ++i) {
+      auto &result = results[i];
+      printf("    { \"benchmark\": \"%s\", \"entities\": %zu, \"ops\": %zu, \"total_ms\": %.3f, \"ns_per_op\": %.2f }%s\n",
+             result.name.c_str(), result.entities, result.ops, result.totalMs,
+             result.totalMs * 1e6 / (double) result.ops, i + 1 < results.size() ? "," : "");
+    }
+    printf("  ]\n}\n");
+  }
+}
+
+int main(int argc, char *argv[]) {
+  bool json = false;
+  size_t maxEntities = 1000000;
+  for (int a = 1; a < argc; ++a) {
+    if (strcmp(argv[a], "--json") == 0) {
+      json = true;
+    } else if (strncmp(argv[a], "--max-entities=", 15) == 0) {
+      maxEntities = strtoull(argv[a] + 15, nullptr, 10);
+    } else {
+      fprintf(stderr, "usage: %s [--json] [--max-entities=N]\n", argv[0]);
+      return strcmp(argv[a], "--help") == 0 ? 0 : 1;
+    }
+  }
+
+  for (size_t count = 1000; count <= maxEntities; count *= 10) {
+    fprintf(stderr, "running benchmarks at %zu entities...\n", count);
+    benchEntitiesAndComps(count);
+    benchListenerDispatch(count);
+    benchClear(count);
+    benchIteration(count);
+    benchSerialization(count);
+  }
+
+  if (json) {
+    printJson();
+  } else {
+    printCsv();
+  }
+  fprintf(stderr, "checksum %llu\n", (unsigned long long) checksum);
+  if (failures) {
+    fprintf(stderr, "%zu component operations failed!\n", failures);
+    return 1;
+  }
+  return 0;
+}